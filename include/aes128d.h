@@ -0,0 +1,76 @@
+/*
+ * AES-128 Decryption Header
+ * -------------------------
+ * This header declares the interface for AES-128 block decryption (the
+ * FIPS-197 inverse cipher), needed by modes that decrypt blocks such as
+ * ECB, CBC and XTS. OFB and CTR only ever use the forward cipher.
+ *
+ * Decryption uses the "equivalent inverse cipher" of FIPS-197 section 5.3.5,
+ * whose round keys are precomputed once per key in an aes128d_ctx. Blocks
+ * are decrypted by the engine selected with aes128_set_backend(), so the
+ * constant-time engines (bitslice, vpaes) decrypt in constant time as well.
+ *
+ */
+#ifndef AES128D_H
+#define AES128D_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aes128e.h"
+
+/**
+ * Equivalent-inverse AES-128 key schedule: the encryption round keys in
+ * reverse order, with InvMixColumns applied to rounds 1 to 9.
+ */
+typedef struct {
+    _Alignas(16) uint8_t RoundKey[176];
+} aes128d_ctx;
+
+/**
+ * Expands a 16-byte AES-128 key into a decryption schedule.
+ *
+ * @param ctx   context to initialise
+ * @param key   16-byte AES-128 key
+ */
+void aes128d_init(aes128d_ctx *ctx, const uint8_t *key);
+
+/**
+ * Derives the decryption schedule from an already expanded encryption key,
+ * for callers that need both directions under the same key.
+ *
+ * @param ctx   context to initialise
+ * @param enc   context initialised by aes128_init()
+ */
+void aes128d_init_from(aes128d_ctx *ctx, const aes128_ctx *enc);
+
+/**
+ * Decrypts a single 16-byte block.
+ *
+ * @param ctx    context initialised by aes128d_init()
+ * @param output 16-byte output buffer (plaintext)
+ * @param input  16-byte input buffer (ciphertext block)
+ */
+void aes128d_block(const aes128d_ctx *ctx, uint8_t *output, const uint8_t *input);
+
+/**
+ * Decrypts nblocks independent 16-byte blocks, interleaving their rounds.
+ * Input and output may be the same buffer.
+ *
+ * @param ctx     context initialised by aes128d_init()
+ * @param output  16 * nblocks byte output buffer
+ * @param input   16 * nblocks byte input buffer
+ * @param nblocks number of blocks
+ */
+void aes128d_blocks(const aes128d_ctx *ctx, uint8_t *output, const uint8_t *input, size_t nblocks);
+
+/**
+ * Decrypts a single 16-byte block using AES-128.
+ * Convenience wrapper that expands the key on every call.
+ *
+ * @param output 16-byte output buffer (plaintext)
+ * @param input  16-byte input buffer (ciphertext block)
+ * @param key    16-byte AES-128 key
+ */
+void aes128d(uint8_t *output, const uint8_t *input, const uint8_t *key);
+
+#endif // AES128D_H
@@ -5,14 +5,152 @@
  * The implementation performs encryption on a single 16-byte block
  * using a 16-byte key according to the FIPS-197 standard.
  *
+ * Callers that encrypt more than one block under the same key should
+ * expand the key once into an aes128_ctx and reuse it, instead of
+ * paying for KeyExpansion on every aes128e() call.
+ *
+ * AES-192 and AES-256 block encryption is declared at the end of this
+ * header; it shares the same round functions.
+ *
  */
 #ifndef AES128E_H
 #define AES128E_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+/**
+ * Expanded AES-128 key schedule (11 round keys of 16 bytes each).
+ * Fill it with aes128_init() and pass it to aes128e_block(). The round keys
+ * are 16-byte aligned so that SIMD engines can load them directly.
+ */
+typedef struct {
+    _Alignas(16) uint8_t RoundKey[176];
+} aes128_ctx;
+
+/**
+ * Expands a 16-byte AES-128 key into ctx.
+ *
+ * @param ctx   context to initialise
+ * @param key   16-byte AES-128 key
+ */
+void aes128_init(aes128_ctx *ctx, const uint8_t *key);
+
+/**
+ * Expands n keys into n contexts in one call. Engines that can work on
+ * several keys at once (AES-NI, vector-permute, bitsliced) process them
+ * in parallel, which makes setup for many short-lived keys much cheaper
+ * than n separate aes128_init() calls.
+ *
+ * @param ctxs  array of n contexts to initialise
+ * @param keys  16 * n bytes: key i is at keys + 16 * i
+ * @param n     number of keys
+ */
+void aes128_init_batch(aes128_ctx *ctxs, const uint8_t *keys, size_t n);
+
+/**
+ * Encrypts a single 16-byte block with an already expanded key.
+ *
+ * @param ctx    context initialised by aes128_init()
+ * @param output 16-byte output buffer (ciphertext)
+ * @param input  16-byte input buffer (plaintext block)
+ */
+void aes128e_block(const aes128_ctx *ctx, uint8_t *output, const uint8_t *input);
+
+/**
+ * Encrypts nblocks independent 16-byte blocks (ECB) with an expanded key.
+ * Engines interleave the rounds of several blocks, so one call with many
+ * blocks is much faster than many aes128e_block() calls. This is the
+ * building block for modes whose blocks are independent (CTR, XTS,
+ * several OFB streams). Input and output may be the same buffer.
+ *
+ * @param ctx     context initialised by aes128_init()
+ * @param output  16 * nblocks byte output buffer
+ * @param input   16 * nblocks byte input buffer
+ * @param nblocks number of blocks
+ */
+void aes128e_blocks(const aes128_ctx *ctx, uint8_t *output, const uint8_t *input, size_t nblocks);
+
+/**
+ * Encrypts n blocks, each under its own key: block i of input is encrypted
+ * with ctxs[i] into block i of output. Lanes with different keys go through
+ * the rounds together, so many small payloads under many keys run close to
+ * the single-key aes128e_blocks() throughput. The same context may appear
+ * several times. Input and output may be the same buffer.
+ *
+ * @param ctxs    n contexts initialised by aes128_init()
+ * @param output  16 * n byte output buffer
+ * @param input   16 * n byte input buffer
+ * @param n       number of blocks (and keys)
+ */
+void aes128e_multikey(const aes128_ctx *const *ctxs, uint8_t *output, const uint8_t *input, size_t n);
+
+/**
+ * Block encryption engines. All of them produce identical output and share
+ * the aes128_ctx key schedule.
+ *
+ *   AES128_BACKEND_AUTO      $AES_BACKEND if set, else the fastest supported of AES-NI,
+ *                            vpaes, T-tables and portable (default)
+ *   AES128_BACKEND_PORTABLE  plain C rounds on 32-bit columns: S-box lookups, SWAR MixColumns
+ *   AES128_BACKEND_TTABLE    32-bit combined SubBytes/ShiftRows/MixColumns tables
+ *   AES128_BACKEND_AESNI     x86 AESENC/AESENCLAST/AESKEYGENASSIST instructions
+ *   AES128_BACKEND_BITSLICE  constant-time bitsliced SSSE3 rounds, 8 blocks per pass;
+ *                            no table lookups, including in the key schedule; no
+ *                            AVX2 variant, since CPUs with AVX2 all have AES-NI
+ *   AES128_BACKEND_VPAES     constant-time vector-permute (SSSE3 PSHUFB) rounds,
+ *                            one block at a time; suited to OFB's single chain
+ *
+ * The constant-time guarantee of bitslice and vpaes covers AES-128 only (in
+ * both directions); AES-192 and AES-256 are not constant-time under them.
+ */
+typedef enum {
+    AES128_BACKEND_AUTO = 0,
+    AES128_BACKEND_PORTABLE,
+    AES128_BACKEND_TTABLE,
+    AES128_BACKEND_AESNI,
+    AES128_BACKEND_BITSLICE,
+    AES128_BACKEND_VPAES
+} aes128_backend;
+
+/**
+ * Selects the engine used by aes128_init(), aes128e_block(), aes128d_block()
+ * and every mode built on them. Contexts stay valid across a change of engine. The engine
+ * must pass a FIPS-197 known-answer self-test before it is used.
+ *
+ * The automatic choice is made once at program start. Setting the
+ * AES_BACKEND environment variable to an engine name (portable, ttable,
+ * aesni, bitslice, vpaes) overrides it, e.g. for A/B benchmarking; an
+ * unusable name falls back to the automatic choice with a warning.
+ *
+ * The switch is a single atomic store of a pointer to the new engine, made
+ * only after the engine has passed its self-test, so it may be called while
+ * other threads (ofb_pipe producers, CTR/XTS/index workers) are encrypting:
+ * each AES call runs entirely on the old engine or entirely on the new one.
+ * A mode that makes many calls can change engine between two of them, which
+ * gives the same output; if the constant-time guarantee of an engine is
+ * needed for a whole message, select it before starting the other threads.
+ *
+ * @param backend engine to use for subsequent calls
+ * @return 0 on success, -1 if the engine is not supported by this CPU
+ *         or failed its self-test (the previous engine stays selected)
+ */
+int aes128_set_backend(aes128_backend backend);
+
+/**
+ * Returns the engine currently in use (never AES128_BACKEND_AUTO; the
+ * automatic choice is resolved at program start).
+ */
+aes128_backend aes128_get_backend(void);
+
+/**
+ * Returns the name of an engine as accepted by AES_BACKEND ("auto" for
+ * AES128_BACKEND_AUTO or an unknown value).
+ */
+const char *aes128_backend_name(aes128_backend backend);
+
 /**
  * Encrypts a single 16-byte block using AES-128.
+ * Convenience wrapper that expands the key on every call.
  * 
  * @param output 16-byte output buffer (ciphertext)
  * @param input 16-byte input buffer (plaintext block)
@@ -20,4 +158,38 @@
  */
 void aes128e(uint8_t *output, const uint8_t *input, const uint8_t *key);
 
+/**
+ * Expanded AES-192 (13 round keys) and AES-256 (15 round keys) schedules.
+ */
+typedef struct {
+    _Alignas(16) uint8_t RoundKey[208];
+} aes192_ctx;
+
+typedef struct {
+    _Alignas(16) uint8_t RoundKey[240];
+} aes256_ctx;
+
+/**
+ * Expands a 24-byte AES-192 key / a 32-byte AES-256 key into ctx.
+ */
+void aes192_init(aes192_ctx *ctx, const uint8_t *key);
+void aes256_init(aes256_ctx *ctx, const uint8_t *key);
+
+/**
+ * Encrypts a single 16-byte block with an expanded AES-192 / AES-256 key.
+ * These use AES-NI when that engine is selected, otherwise the unrolled
+ * portable rounds, including under the bitslice and vpaes engines. The
+ * portable rounds and aes192_init()/aes256_init() look up the S-box in a
+ * table indexed by key and data, so they are not constant-time: where
+ * cache-timing attacks matter and AES-NI is unavailable, use AES-128.
+ */
+void aes192e_block(const aes192_ctx *ctx, uint8_t *output, const uint8_t *input);
+void aes256e_block(const aes256_ctx *ctx, uint8_t *output, const uint8_t *input);
+
+/**
+ * One-shot AES-192 / AES-256 block encryption (expands the key on every call).
+ */
+void aes192e(uint8_t *output, const uint8_t *input, const uint8_t *key);
+void aes256e(uint8_t *output, const uint8_t *input, const uint8_t *key);
+
 #endif // AES128E_H
\ No newline at end of file
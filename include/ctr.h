@@ -0,0 +1,80 @@
+/*
+ * AES-128 CTR Mode Header
+ * -----------------------
+ * Counter mode (NIST SP 800-38A, 6.5): keystream block j is E_K(T + j),
+ * where T is the initial counter block and the addition is modulo 2^128.
+ * Unlike OFB, every keystream block can be computed on its own, so the
+ * keystream comes from the batched multi-block AES path, a large input can
+ * be split by counter range across threads, and any byte offset can be
+ * reached in O(1).
+ *
+ * As with OFB, encryption and decryption are the same operation, and a
+ * counter block must never be reused under the same key.
+ *
+ */
+#ifndef CTR_H
+#define CTR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aes128e.h"
+
+/**
+ * Encrypts (or decrypts) length bytes in one call. On return counter has been
+ * advanced past the blocks used, so when length is a multiple of 16 a second
+ * call with the same counter continues the same stream.
+ */
+void CTRaes128e(uint8_t *ciphertext, const uint8_t *plaintext, size_t length,
+                uint8_t *counter, const uint8_t *key);
+
+/**
+ * Incremental CTR state: the expanded key, the initial counter block, the
+ * stream position and the keystream block for a position inside a block.
+ */
+typedef struct {
+    aes128_ctx key;
+    uint8_t counter[16];
+    uint8_t keystream[16];
+    uint64_t offset;
+} ctr_ctx;
+
+/**
+ * Starts a stream under key and the 16-byte initial counter block.
+ */
+void ctr_init(ctr_ctx *ctx, const uint8_t *key, const uint8_t *counter);
+
+/**
+ * Encrypts (or decrypts) the next len bytes of the stream. Chunks may have
+ * any size; output may overlap input only if they are identical.
+ */
+void ctr_update(ctr_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len);
+
+/**
+ * Moves the stream to byte offset; costs at most one AES call.
+ */
+void ctr_seek(ctr_ctx *ctx, uint64_t offset);
+
+/**
+ * ctr_update() split by counter range across up to threads threads (the
+ * caller included). Inputs too small to be worth a thread run serially.
+ */
+void ctr_update_parallel(ctr_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len, unsigned threads);
+
+/**
+ * Wipes the key schedule and keystream from ctx.
+ */
+void ctr_final(ctr_ctx *ctx);
+
+/**
+ * Encrypts (or decrypts) the bytes at stream offsets [offset, offset + length)
+ * of in_fd to out_fd, starting at position 0 of out_fd, on up to threads
+ * threads. Both files are accessed with pread/pwrite, so the output must be
+ * seekable.
+ *
+ * @return 0 on success, -1 on an I/O error or if in_fd ends before
+ *         offset + length (errno is set)
+ */
+int ctr_crypt_fd(int in_fd, int out_fd, const uint8_t *key, const uint8_t *counter,
+                 uint64_t offset, uint64_t length, unsigned threads);
+
+#endif // CTR_H
@@ -0,0 +1,138 @@
+/*
+ * AES-128-GCM Header
+ * ------------------
+ * Galois/Counter Mode (NIST SP 800-38D): CTR encryption with a 32-bit
+ * counter, authenticated together with additional data (AAD) by GHASH, a
+ * polynomial hash in GF(2^128) under H = E_K(0^128).
+ *
+ * GHASH uses the PCLMULQDQ carry-less multiply where the CPU has it, with
+ * precomputed powers H^1..H^8 so that eight blocks are multiplied and summed
+ * before a single reduction; elsewhere it falls back to Shoup's 4-bit
+ * tables. With the AES-NI engine selected, the CTR keystream and GHASH run
+ * in one loop, the AESENC and PCLMULQDQ instructions of eight blocks
+ * interleaved so both units stay busy.
+ *
+ * The 4-bit table lookups depend on H and the data; where timing side
+ * channels matter, use a CPU with PCLMULQDQ. An IV must never be reused
+ * under the same key.
+ *
+ */
+#ifndef GCM_H
+#define GCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aes128e.h"
+
+/*
+ * Limits of SP 800-38D per message: at most 2^32 - 2 blocks of text, since
+ * the 32-bit counter must not come back to a value already used, and less
+ * than 2^64 bits of AAD.
+ */
+#define GCM_MAX_TEXT_LEN ((UINT64_C(1) << 36) - 32)
+#define GCM_MAX_AAD_LEN  ((UINT64_C(1) << 61) - 1)
+
+/**
+ * GCM state. The key part (gcm_init) can serve any number of messages, each
+ * started with gcm_start().
+ */
+typedef struct {
+    aes128_ctx key;
+    _Alignas(16) uint8_t hkey[256];  // GHASH key: powers of H or 4-bit tables
+    uint8_t j0[16];                  // pre-counter block, encrypted for the tag
+    uint8_t counter[16];             // counter block of the next keystream block
+    uint8_t x[16];                   // GHASH accumulator
+    uint8_t partial[16];             // GHASH input not yet absorbed
+    uint8_t keystream[16];           // keystream of a block in progress
+    unsigned partial_len;
+    uint64_t aad_len, text_len;      // bytes so far
+} gcm_ctx;
+
+/**
+ * Sets up the key: expands it and computes the GHASH key.
+ */
+void gcm_init(gcm_ctx *ctx, const uint8_t *key);
+
+/**
+ * Starts a message under an iv of iv_len bytes (12 is recommended; other
+ * lengths are hashed into the pre-counter block as SP 800-38D specifies).
+ *
+ * @return 0 on success, -1 if iv_len is 0
+ */
+int gcm_start(gcm_ctx *ctx, const uint8_t *iv, size_t iv_len);
+
+/**
+ * Adds len bytes of additional authenticated data. All AAD must come before
+ * the first gcm_encrypt()/gcm_decrypt() of the message; chunks may have any
+ * size.
+ *
+ * @return 0 on success, -1 if text has already been processed or the AAD
+ *         would exceed GCM_MAX_AAD_LEN
+ */
+int gcm_aad(gcm_ctx *ctx, const uint8_t *aad, size_t len);
+
+/**
+ * Encrypts the next len bytes of the message. Chunks may have any size;
+ * output may overlap input only if they are identical.
+ *
+ * @return 0 on success, -1 if the message would exceed GCM_MAX_TEXT_LEN
+ *         (nothing is processed; the message so far can still be finished)
+ */
+int gcm_encrypt(gcm_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len);
+
+/**
+ * Decrypts the next len bytes of the message. The plaintext must not be
+ * trusted until gcm_verify() succeeds.
+ *
+ * @return 0 on success, -1 if the message would exceed GCM_MAX_TEXT_LEN
+ */
+int gcm_decrypt(gcm_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len);
+
+/**
+ * Ends the message and writes the first tag_len (at most 16) bytes of its
+ * tag. The key part of ctx stays usable for the next gcm_start().
+ */
+void gcm_finish(gcm_ctx *ctx, uint8_t *tag, size_t tag_len);
+
+/**
+ * Ends the message and compares its tag with the expected tag_len bytes in
+ * constant time. tag_len must be 16, 15, 14, 13 or 12.
+ *
+ * @return 0 if the tags match, -1 if they differ or tag_len is not allowed
+ */
+int gcm_verify(gcm_ctx *ctx, const uint8_t *tag, size_t tag_len);
+
+/**
+ * gcm_verify() that also accepts 8- and 4-byte tags. SP 800-38D Appendix C
+ * allows these only for short messages and with a bounded number of failed
+ * verifications per key; the caller has to enforce both.
+ */
+int gcm_verify_short(gcm_ctx *ctx, const uint8_t *tag, size_t tag_len);
+
+/**
+ * Wipes the key schedule, GHASH key and message state from ctx.
+ */
+void gcm_final(gcm_ctx *ctx);
+
+/**
+ * One-shot encryption: len bytes of plaintext to ciphertext and a 16-byte tag
+ * over the ciphertext and aad_len bytes of aad.
+ *
+ * @return 0 on success, -1 if iv_len is 0 or len or aad_len is over the
+ *         limit (no tag is written)
+ */
+int aes128_gcm_encrypt(uint8_t *ciphertext, uint8_t *tag, const uint8_t *plaintext, size_t len,
+                        const uint8_t *aad, size_t aad_len,
+                        const uint8_t *iv, size_t iv_len, const uint8_t *key);
+
+/**
+ * One-shot decryption. On a tag mismatch the plaintext buffer is zeroed.
+ *
+ * @return 0 if the 16-byte tag is valid, -1 otherwise (including an iv_len
+ *         of 0 and lengths over the limits)
+ */
+int aes128_gcm_decrypt(uint8_t *plaintext, const uint8_t *ciphertext, size_t len,
+                       const uint8_t *aad, size_t aad_len, const uint8_t *tag,
+                       const uint8_t *iv, size_t iv_len, const uint8_t *key);
+
+#endif // GCM_H
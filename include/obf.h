@@ -8,14 +8,112 @@
  * The function performs encryption (and decryption, since OFB is symmetric)
  * of a given plaintext using a provided 128-bit AES key and initialization vector (IV).
  *
+ * For data that does not fit in memory, or arrives in pieces, the ofb_ctx
+ * functions process a stream incrementally in chunks of any size.
  */
 
 #ifndef OFB_H
 #define OFB_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <sys/uio.h>
+#include "aes128e.h"
 
-void OFBaes128e(uint8_t *ciphertext, const uint8_t *plaintext, uint32_t length,
+/**
+ * Encrypts (or decrypts) length bytes in one call. On return iv holds the
+ * last keystream block, so when length is a multiple of 16 a second call
+ * with the same iv continues the same stream.
+ */
+void OFBaes128e(uint8_t *ciphertext, const uint8_t *plaintext, size_t length,
                 uint8_t *iv, const uint8_t *key);
 
-#endif // OFB_H
\ No newline at end of file
+/**
+ * Incremental OFB state: the expanded key, the feedback register (which is
+ * also the current keystream block) and how many of its bytes are used up.
+ */
+typedef struct {
+    aes128_ctx key;
+    uint8_t feedback[16];
+    unsigned used;
+} ofb_ctx;
+
+/**
+ * Starts a stream under key and the 16-byte iv.
+ */
+void ofb_init(ofb_ctx *ctx, const uint8_t *key, const uint8_t *iv);
+
+/**
+ * Encrypts (or decrypts) the next len bytes of the stream. Chunks may have
+ * any size; a sequence of updates gives the same output as one call over the
+ * concatenated input. Output may overlap input only if they are identical.
+ */
+void ofb_update(ofb_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len);
+
+/**
+ * Scatter-gather ofb_update(): encrypts the bytes described by the n entries
+ * of in into the n entries of out, without gathering them into one buffer.
+ * Both arrays must have exactly n entries (use empty entries to pad the
+ * shorter list). The two lists may be fragmented differently, but must
+ * describe the same total length; the keystream position carries across
+ * fragment boundaries of any size, so the result is the same as one
+ * ofb_update() over the concatenated data. Returns 0, or -1 without touching
+ * the stream when the totals differ or do not fit in a size_t.
+ */
+int ofb_update_iov(ofb_ctx *ctx, const struct iovec *in, const struct iovec *out, size_t n);
+
+/**
+ * Advances the stream by len bytes without producing output, as if len
+ * bytes had been passed to ofb_update(). This still costs one AES call per
+ * block skipped.
+ */
+void ofb_skip(ofb_ctx *ctx, uint64_t len);
+
+/**
+ * A stream position saved by ofb_save(): the feedback register and how many
+ * of its bytes are used (16 at a block boundary). Resuming from it needs
+ * only the key, not the data before it. feedback is keystream; see
+ * ofb_state.h for storing it.
+ */
+typedef struct {
+    uint8_t feedback[16];
+    unsigned used;
+} ofb_state;
+
+/**
+ * Saves the position of a stream.
+ */
+void ofb_save(const ofb_ctx *ctx, ofb_state *state);
+
+/**
+ * Continues a stream saved by ofb_save() under key; the next ofb_update()
+ * picks up exactly where the saved stream stopped, mid-block included.
+ *
+ * @return 0 on success, -1 if state->used is out of range
+ */
+int ofb_resume(ofb_ctx *ctx, const uint8_t *key, const ofb_state *state);
+
+/**
+ * Number of streams ofb_update_multi() advances together.
+ */
+#define OFB_LANES 8
+
+/**
+ * Multi-buffer OFB: advances n independent streams at once, stream i
+ * encrypting len[i] bytes from in[i] to out[i] under ctxs[i]. Each single
+ * OFB chain waits on its previous AES output, but the chains of different
+ * streams are independent, so groups of OFB_LANES streams go through the
+ * multi-key AES path in lockstep. Streams may have different keys, IVs and
+ * lengths; the result is the same as n separate ofb_update() calls.
+ */
+void ofb_update_multi(ofb_ctx *const *ctxs, uint8_t *const *out, const uint8_t *const *in,
+                      const size_t *len, size_t n);
+
+/**
+ * Ends the stream and wipes the key schedule from ctx. If iv is not NULL it
+ * receives the feedback register, which continues the stream from the next
+ * block boundary when passed to ofb_init().
+ */
+void ofb_final(ofb_ctx *ctx, uint8_t *iv);
+
+#endif // OFB_H
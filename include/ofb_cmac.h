@@ -0,0 +1,97 @@
+/*
+ * AES-128 CMAC and Authenticated OFB Header
+ * -----------------------------------------
+ * AES-CMAC (NIST SP 800-38B, RFC 4493) on its own, and an encrypt-then-MAC
+ * mode that computes the CMAC of the IV and ciphertext in the same loop that
+ * produces the ciphertext, so every byte is read from memory once.
+ *
+ * Each step of the combined loop needs the next OFB keystream block and the
+ * next CMAC chaining value. Both are single AES calls on a serial chain, but
+ * the two chains are independent of each other, so they go through the
+ * multi-key AES path together (aes128e_multikey) and one chain's AES latency
+ * hides the other's: integrity costs far less than a second pass.
+ *
+ * Use separate keys for encryption and authentication.
+ *
+ */
+#ifndef OFB_CMAC_H
+#define OFB_CMAC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "obf.h"
+
+/**
+ * Incremental CMAC state. The last block of the message is processed
+ * differently from the others, so the most recent block is held back until
+ * more data shows it is not the last.
+ */
+typedef struct {
+    aes128_ctx key;
+    uint8_t k1[16], k2[16];   // subkeys for a complete and a padded last block
+    uint8_t x[16];            // chaining value
+    uint8_t pending[16];      // data not yet absorbed into x
+    unsigned pending_len;
+} aes128_cmac_ctx;
+
+/**
+ * Starts a CMAC under the 16-byte key.
+ */
+void aes128_cmac_init(aes128_cmac_ctx *ctx, const uint8_t *key);
+
+/**
+ * Adds len bytes to the message. Chunks may have any size.
+ */
+void aes128_cmac_update(aes128_cmac_ctx *ctx, const uint8_t *data, size_t len);
+
+/**
+ * Writes the 16-byte tag and wipes ctx.
+ */
+void aes128_cmac_final(aes128_cmac_ctx *ctx, uint8_t *tag);
+
+/**
+ * One-shot CMAC of len bytes of msg.
+ */
+void aes128_cmac(uint8_t *tag, const uint8_t *msg, size_t len, const uint8_t *key);
+
+/**
+ * Authenticated OFB stream: OFB under one key, and under another the CMAC of
+ * the IV followed by the ciphertext, CMAC(K_mac, IV || C).
+ */
+typedef struct {
+    ofb_ctx ofb;
+    aes128_cmac_ctx mac;
+} ofb_cmac_ctx;
+
+/**
+ * Starts a stream under the encryption key, the MAC key and the 16-byte iv.
+ */
+void ofb_cmac_init(ofb_cmac_ctx *ctx, const uint8_t *key, const uint8_t *mac_key, const uint8_t *iv);
+
+/**
+ * Encrypts the next len bytes and adds the ciphertext to the MAC. Chunks may
+ * have any size; output may overlap input only if they are identical.
+ */
+void ofb_cmac_encrypt(ofb_cmac_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len);
+
+/**
+ * Adds the next len bytes of ciphertext to the MAC and decrypts them. The
+ * plaintext must not be trusted until ofb_cmac_verify() succeeds.
+ */
+void ofb_cmac_decrypt(ofb_cmac_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len);
+
+/**
+ * Ends the stream, writes the 16-byte tag of the IV and ciphertext and wipes
+ * ctx.
+ */
+void ofb_cmac_final(ofb_cmac_ctx *ctx, uint8_t *tag);
+
+/**
+ * Ends the stream and compares its tag with the expected one in constant
+ * time, then wipes ctx.
+ *
+ * @return 0 if the tags match, -1 otherwise
+ */
+int ofb_cmac_verify(ofb_cmac_ctx *ctx, const uint8_t *tag);
+
+#endif // OFB_CMAC_H
@@ -0,0 +1,114 @@
+/*
+ * AES-128 OFB Checkpoint Index Header
+ * -----------------------------------
+ * OFB decryption is serial: block N's keystream needs the N-1 AES calls
+ * before it. A checkpoint index records the feedback register every
+ * `interval` bytes while a file is encrypted. Each segment between two
+ * checkpoints is then an independent OFB stream with the checkpoint as its
+ * IV, so decryption can run on all cores. The ciphertext is unchanged; the
+ * index is a separate sidecar file.
+ *
+ * A feedback register is a keystream block, and would expose one block of
+ * plaintext per checkpoint if stored as is. The index therefore stores each
+ * checkpoint encrypted under a key derived from the file key, and reading it
+ * needs the same key and IV that decrypt the file.
+ *
+ */
+#ifndef OFB_INDEX_H
+#define OFB_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "obf.h"
+
+typedef struct {
+    uint64_t interval;     // bytes between checkpoints (a multiple of 16)
+    uint64_t length;       // bytes of data the index covers
+    size_t count;          // checkpoints, at interval, 2 * interval, ...
+    uint8_t *checkpoints;  // 16 * count bytes of feedback registers
+} ofb_index;
+
+/**
+ * Starts an empty index with checkpoints every interval bytes.
+ *
+ * @return 0 on success, -1 if interval is zero or not a multiple of 16
+ */
+int ofb_index_init(ofb_index *index, uint64_t interval);
+
+/**
+ * Appends the next checkpoint: the feedback register of a stream that has
+ * processed exactly (index->count + 1) * interval bytes (see ofb_ctx).
+ *
+ * @return 0 on success, -1 if memory runs out
+ */
+int ofb_index_add(ofb_index *index, const uint8_t *feedback);
+
+/**
+ * Writes the index, with its checkpoints masked, to path. index->length must
+ * be set to the length of the data first; there must be one checkpoint for
+ * every whole interval in it (length / interval).
+ *
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int ofb_index_save(const char *path, const ofb_index *index, const uint8_t *key, const uint8_t *iv);
+
+/**
+ * Reads an index written by ofb_index_save().
+ *
+ * @return 0 on success, -1 on error; errno is EINVAL if the file is not an
+ *         index or belongs to another key or IV
+ */
+int ofb_index_load(const char *path, ofb_index *index, const uint8_t *key, const uint8_t *iv);
+
+/**
+ * Releases the checkpoints of an index.
+ */
+void ofb_index_free(ofb_index *index);
+
+/**
+ * Decrypts (or encrypts) index->length bytes from in_fd to out_fd, one
+ * segment per checkpoint, on up to threads threads. The output file is
+ * written with pwrite and must be seekable.
+ *
+ * @return 0 on success, -1 on an I/O error or if in_fd is not
+ *         index->length bytes long (errno is set)
+ */
+int ofb_index_decrypt(int in_fd, int out_fd, const ofb_index *index,
+                      const uint8_t *key, const uint8_t *iv, unsigned threads);
+
+/**
+ * Seekable OFB reader: random access to a stream through an index. A seek
+ * restarts the keystream from the nearest checkpoint at or before the
+ * target, so reading a range costs at most one interval of keystream beyond
+ * the range itself.
+ */
+typedef struct {
+    ofb_ctx stream;
+    const ofb_index *index;  // may be NULL: seeks then start from the IV
+    uint8_t iv[16];
+    uint64_t offset;         // stream position of the next byte read
+} ofb_reader;
+
+/**
+ * Starts a reader at offset 0. index must stay valid while the reader is used.
+ */
+void ofb_reader_init(ofb_reader *reader, const uint8_t *key, const uint8_t *iv, const ofb_index *index);
+
+/**
+ * Moves the reader to stream offset. Seeking forward within the current
+ * segment continues from the current position.
+ */
+void ofb_seek(ofb_reader *reader, uint64_t offset);
+
+/**
+ * Decrypts (or encrypts) len bytes, in holding the bytes of the stream at the
+ * reader's offset, and advances the offset by len.
+ */
+void ofb_read(ofb_reader *reader, uint8_t *out, const uint8_t *in, size_t len);
+
+/**
+ * Wipes the reader's key schedule and keystream.
+ */
+void ofb_reader_final(ofb_reader *reader);
+
+#endif // OFB_INDEX_H
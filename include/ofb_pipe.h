@@ -0,0 +1,48 @@
+/*
+ * Pipelined AES-128 OFB Header
+ * ----------------------------
+ * The OFB keystream depends only on the key and IV, never on the data. An
+ * ofb_pipe generates it ahead of time on a background producer thread and
+ * hands it to the caller through a single-producer/single-consumer ring,
+ * lock-free while both sides keep up, so the calling thread only XORs. A
+ * side kept waiting sleeps instead of spinning. This is opt-in: it pays off when
+ * another core is free, and costs a thread per stream.
+ *
+ */
+#ifndef OFB_PIPE_H
+#define OFB_PIPE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Keystream blocks held by the ring (64 KiB), and blocks the producer
+ * generates between two publications of its position.
+ */
+#define OFB_PIPE_BLOCKS 4096
+#define OFB_PIPE_BATCH  64
+
+typedef struct ofb_pipe ofb_pipe;
+
+/**
+ * Starts a stream under key and the 16-byte iv and launches its producer.
+ *
+ * @return the stream, or NULL if memory or the thread could not be
+ *         obtained (use ofb_init() instead)
+ */
+ofb_pipe *ofb_pipe_start(const uint8_t *key, const uint8_t *iv);
+
+/**
+ * Encrypts (or decrypts) the next len bytes of the stream, with the same
+ * result as ofb_update() on a stream started from the same key and IV.
+ * Only one thread may call this for a given stream.
+ */
+void ofb_pipe_update(ofb_pipe *pipe, uint8_t *out, const uint8_t *in, size_t len);
+
+/**
+ * Stops the producer, wipes the keystream and frees the stream. If iv is not
+ * NULL it receives the feedback register, as ofb_final() does.
+ */
+void ofb_pipe_finish(ofb_pipe *pipe, uint8_t *iv);
+
+#endif // OFB_PIPE_H
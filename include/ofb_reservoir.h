@@ -0,0 +1,89 @@
+/*
+ * AES-128 OFB Keystream Reservoir Header
+ * --------------------------------------
+ * The OFB keystream depends only on the key and IV, so it can be generated
+ * in advance, when the machine is idle, into a reservoir file. Encryption at
+ * a busy time is then a plain XOR against the file (mapped with mmap), with
+ * no AES work at all.
+ *
+ * The file records how many keystream blocks have been handed out. That
+ * marker is advanced and flushed to disk before any keystream is used, and
+ * used keystream is overwritten with zeros, so no keystream is ever used
+ * twice, even after a crash. Each message starts on a block boundary, and
+ * the IV reported for it lets it be decrypted with the ordinary OFB
+ * functions and the original key.
+ *
+ * The IV of a message is the last keystream block of the one before it, so
+ * it is reported masked (encrypted under a key derived from the file key),
+ * like the feedback values of a checkpoint index (ofb_index.h).
+ * ofb_reservoir_iv() turns it back into the OFB IV given the key.
+ *
+ * The reservoir holds raw keystream: protect it like the key.
+ *
+ */
+#ifndef OFB_RESERVOIR_H
+#define OFB_RESERVOIR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ofb_reservoir ofb_reservoir;
+
+/**
+ * Generates a reservoir with at least bytes of keystream for key and the
+ * 16-byte iv, replacing any existing file at path.
+ *
+ * @return 0 on success, -1 on error (errno is set)
+ */
+int ofb_reservoir_create(const char *path, const uint8_t *key, const uint8_t *iv, uint64_t bytes);
+
+/**
+ * Opens a reservoir for use. Several processes may share one reservoir;
+ * each message takes its keystream under an exclusive file lock.
+ *
+ * @return the reservoir, or NULL on error (errno is set)
+ */
+ofb_reservoir *ofb_reservoir_open(const char *path);
+
+/**
+ * Returns the number of keystream bytes not yet handed out.
+ */
+uint64_t ofb_reservoir_remaining(const ofb_reservoir *res);
+
+/**
+ * Reserves keystream for a message of len bytes and writes the masked OFB IV
+ * that produces exactly that keystream to iv. The IV is safe to publish next
+ * to the ciphertext; ofb_reservoir_iv() unmasks it, after which
+ * ofb_init(key, iv) followed by ofb_update() decrypts the message. The
+ * reserved keystream is then used by ofb_reservoir_update().
+ *
+ * @return 0 on success, -1 if not enough keystream is left (errno is ENOSPC)
+ *         or the marker could not be saved
+ */
+int ofb_reservoir_begin(ofb_reservoir *res, uint64_t len, uint8_t *iv);
+
+/**
+ * Recovers the OFB IV of a message from the masked IV that
+ * ofb_reservoir_begin() published for it, given the key the reservoir was
+ * created with. iv and published may be the same buffer.
+ */
+void ofb_reservoir_iv(uint8_t *iv, const uint8_t *published, const uint8_t *key);
+
+/**
+ * Encrypts the next len bytes of the message started by ofb_reservoir_begin(),
+ * wiping the keystream it uses. Every call except the last must pass a
+ * multiple of 16 bytes, and the calls together may not exceed the reserved
+ * length.
+ *
+ * @return 0 on success, -1 if len exceeds the reservation (errno is ENOSPC)
+ *         or an earlier call of the message passed a partial block (errno
+ *         is EINVAL)
+ */
+int ofb_reservoir_update(ofb_reservoir *res, uint8_t *out, const uint8_t *in, size_t len);
+
+/**
+ * Unmaps and closes the reservoir. Reserved but unused keystream is wiped.
+ */
+void ofb_reservoir_close(ofb_reservoir *res);
+
+#endif // OFB_RESERVOIR_H
@@ -0,0 +1,42 @@
+/*
+ * AES-128 OFB Saved Stream State Header
+ * -------------------------------------
+ * Lets an encrypted append-only file grow without touching what is already
+ * in it. After each write the stream position (an ofb_state and the number
+ * of bytes written so far) is saved to a small sidecar file; the next append
+ * resumes the stream from it, so its cost depends only on the bytes added.
+ *
+ * The feedback register is a keystream block and would expose the plaintext
+ * of the last (partial) block if stored as is, so the file holds it
+ * encrypted under a key derived from the file key, as the checkpoint index
+ * does (ofb_index.h). Loading it needs the key and IV of the stream.
+ *
+ */
+#ifndef OFB_STATE_H
+#define OFB_STATE_H
+
+#include <stdint.h>
+#include "obf.h"
+
+/**
+ * Saves state, the position of a stream that has processed length bytes
+ * under key and iv, to path. The file is replaced atomically (written next
+ * to it and renamed), so a crash leaves either the old or the new state.
+ *
+ * @return 0 on success, -1 on error (errno is set; EINVAL if state->used
+ *         does not match length)
+ */
+int ofb_state_save(const char *path, const ofb_state *state, uint64_t length,
+                   const uint8_t *key, const uint8_t *iv);
+
+/**
+ * Reads a state written by ofb_state_save() and the stream length it was
+ * saved at.
+ *
+ * @return 0 on success, -1 on error; errno is EINVAL if the file is not a
+ *         saved state or belongs to another key or IV
+ */
+int ofb_state_load(const char *path, ofb_state *state, uint64_t *length,
+                   const uint8_t *key, const uint8_t *iv);
+
+#endif // OFB_STATE_H
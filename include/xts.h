@@ -0,0 +1,104 @@
+/*
+ * AES-128-XTS Header
+ * ------------------
+ * XTS (IEEE 1619, NIST SP 800-38E) for sector-based storage such as disk
+ * images. Each sector is a data unit of its own: block j of sector s is
+ *
+ *   C_j = E_K1(P_j ^ T_j) ^ T_j,   T_j = E_K2(s) * alpha^j  in GF(2^128)
+ *
+ * with s as a 128-bit little-endian number. Sectors are encrypted and
+ * decrypted independently and in place, so an image can be read or updated
+ * one sector at a time, and a range of sectors can be split across threads.
+ * Tweaks and blocks go through the batched multi-block AES path, several
+ * sectors at a time for small sector sizes.
+ *
+ * XTS gives confidentiality only. Rewriting a sector is visible to anyone
+ * who sees both versions, and ciphertext can be replaced without detection.
+ * K1 and K2 must be independent keys.
+ *
+ */
+#ifndef XTS_H
+#define XTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aes128e.h"
+#include "aes128d.h"
+
+// Sector sizes accepted by xts_init(): multiples of 16 bytes in this range
+#define XTS_MIN_SECTOR_SIZE 16
+#define XTS_MAX_SECTOR_SIZE (16 * 1024 * 1024)
+
+/**
+ * XTS key: the data key K1 (both directions), the tweak key K2 and the
+ * sector size. Read-only once set up, so threads may share one.
+ */
+typedef struct {
+    aes128_ctx data;
+    aes128d_ctx data_dec;
+    aes128_ctx tweak;
+    size_t sector_size;
+} xts_ctx;
+
+/**
+ * Sets up the data key, tweak key and sector size (in bytes).
+ *
+ * @return 0 on success, -1 if sector_size is not a multiple of 16 in
+ *         [XTS_MIN_SECTOR_SIZE, XTS_MAX_SECTOR_SIZE] or the two keys are equal
+ */
+int xts_init(xts_ctx *ctx, const uint8_t *key, const uint8_t *tweak_key, size_t sector_size);
+
+/**
+ * Encrypts nsectors whole sectors, the first of which is sector number
+ * sector. Output may overlap input only if they are identical.
+ */
+void xts_encrypt(const xts_ctx *ctx, uint8_t *out, const uint8_t *in, uint64_t sector, size_t nsectors);
+
+/**
+ * Decrypts nsectors whole sectors, the first of which is sector number sector.
+ */
+void xts_decrypt(const xts_ctx *ctx, uint8_t *out, const uint8_t *in, uint64_t sector, size_t nsectors);
+
+/**
+ * xts_encrypt()/xts_decrypt() split by sector range across up to threads
+ * threads (the caller included). Inputs too small to be worth a thread run
+ * serially.
+ */
+void xts_encrypt_parallel(const xts_ctx *ctx, uint8_t *out, const uint8_t *in, uint64_t sector,
+                          size_t nsectors, unsigned threads);
+void xts_decrypt_parallel(const xts_ctx *ctx, uint8_t *out, const uint8_t *in, uint64_t sector,
+                          size_t nsectors, unsigned threads);
+
+/**
+ * Reads sectors [sector, sector + nsectors) of the encrypted image fd and
+ * decrypts them into plaintext.
+ *
+ * @return 0 on success, -1 on an I/O error or a short image (errno is set)
+ */
+int xts_read_sectors(const xts_ctx *ctx, int fd, uint8_t *plaintext, uint64_t sector, size_t nsectors);
+
+/**
+ * Encrypts nsectors sectors of plaintext and writes them over sectors
+ * [sector, sector + nsectors) of the image fd, leaving the rest untouched.
+ *
+ * @return 0 on success, -1 on an I/O error (errno is set)
+ */
+int xts_write_sectors(const xts_ctx *ctx, int fd, const uint8_t *plaintext, uint64_t sector, size_t nsectors);
+
+/**
+ * Encrypts (or decrypts) bytes [offset, offset + length) of in_fd to out_fd,
+ * starting at position 0 of out_fd, on up to threads threads. offset and
+ * length must be whole sectors; the first sector is offset / sector_size.
+ *
+ * @return 0 on success, -1 on an I/O error, a range that is not whole
+ *         sectors, or if in_fd ends before offset + length (errno is set)
+ */
+int xts_crypt_fd(int in_fd, int out_fd, const xts_ctx *ctx, uint64_t offset, uint64_t length,
+                 unsigned threads, int decrypt);
+
+/**
+ * Wipes both key schedules from ctx.
+ */
+void xts_final(xts_ctx *ctx);
+
+#endif // XTS_H
@@ -0,0 +1,563 @@
+/********************************************************************************
+ * aes128d.c
+ *
+ * This file implements AES-128 block decryption with the equivalent inverse
+ * cipher of FIPS-197 section 5.3.5. Applying InvMixColumns to the middle round
+ * keys lets every decryption round have the same shape as an encryption
+ * round (InvSubBytes, InvShiftRows, InvMixColumns, AddRoundKey), so it can be
+ * computed with 32-bit tables or with the AESDEC instruction.
+ *
+ * Two engines are provided here:
+ *   - Td tables: Td0[x] holds the column (0e, 09, 0d, 0b) * InvS[x] in
+ *     big-endian order and Td1..Td3 are its byte rotations; Td4 is the
+ *     inverse S-box for the last round. Used by the portable and T-table
+ *     engines, which are not constant-time either.
+ *   - AES-NI: AESDEC/AESDECLAST, for the AES-NI engine.
+ * The constant-time engines decrypt with the bitsliced inverse cipher in
+ * aes128e_bitslice.c. Each encryption engine's decryption functions are
+ * part of its entry in the engine registry (aes128e.c), which also provides
+ * aes128d_block and aes128d_blocks.
+ ********************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "../include/aes128d.h"
+#include "aes128e_impl.h"
+
+#define GETU32(p) (((uint32_t)(p)[0] << 24) ^ ((uint32_t)(p)[1] << 16) ^ \
+                   ((uint32_t)(p)[2] << 8) ^ ((uint32_t)(p)[3]))
+#define PUTU32(p, v) { (p)[0] = (uint8_t)((v) >> 24); (p)[1] = (uint8_t)((v) >> 16); \
+                       (p)[2] = (uint8_t)((v) >> 8); (p)[3] = (uint8_t)(v); }
+
+static const uint32_t Td0[256] = {
+    0x51F4A750U, 0x7E416553U, 0x1A17A4C3U, 0x3A275E96U,
+    0x3BAB6BCBU, 0x1F9D45F1U, 0xACFA58ABU, 0x4BE30393U,
+    0x2030FA55U, 0xAD766DF6U, 0x88CC7691U, 0xF5024C25U,
+    0x4FE5D7FCU, 0xC52ACBD7U, 0x26354480U, 0xB562A38FU,
+    0xDEB15A49U, 0x25BA1B67U, 0x45EA0E98U, 0x5DFEC0E1U,
+    0xC32F7502U, 0x814CF012U, 0x8D4697A3U, 0x6BD3F9C6U,
+    0x038F5FE7U, 0x15929C95U, 0xBF6D7AEBU, 0x955259DAU,
+    0xD4BE832DU, 0x587421D3U, 0x49E06929U, 0x8EC9C844U,
+    0x75C2896AU, 0xF48E7978U, 0x99583E6BU, 0x27B971DDU,
+    0xBEE14FB6U, 0xF088AD17U, 0xC920AC66U, 0x7DCE3AB4U,
+    0x63DF4A18U, 0xE51A3182U, 0x97513360U, 0x62537F45U,
+    0xB16477E0U, 0xBB6BAE84U, 0xFE81A01CU, 0xF9082B94U,
+    0x70486858U, 0x8F45FD19U, 0x94DE6C87U, 0x527BF8B7U,
+    0xAB73D323U, 0x724B02E2U, 0xE31F8F57U, 0x6655AB2AU,
+    0xB2EB2807U, 0x2FB5C203U, 0x86C57B9AU, 0xD33708A5U,
+    0x302887F2U, 0x23BFA5B2U, 0x02036ABAU, 0xED16825CU,
+    0x8ACF1C2BU, 0xA779B492U, 0xF307F2F0U, 0x4E69E2A1U,
+    0x65DAF4CDU, 0x0605BED5U, 0xD134621FU, 0xC4A6FE8AU,
+    0x342E539DU, 0xA2F355A0U, 0x058AE132U, 0xA4F6EB75U,
+    0x0B83EC39U, 0x4060EFAAU, 0x5E719F06U, 0xBD6E1051U,
+    0x3E218AF9U, 0x96DD063DU, 0xDD3E05AEU, 0x4DE6BD46U,
+    0x91548DB5U, 0x71C45D05U, 0x0406D46FU, 0x605015FFU,
+    0x1998FB24U, 0xD6BDE997U, 0x894043CCU, 0x67D99E77U,
+    0xB0E842BDU, 0x07898B88U, 0xE7195B38U, 0x79C8EEDBU,
+    0xA17C0A47U, 0x7C420FE9U, 0xF8841EC9U, 0x00000000U,
+    0x09808683U, 0x322BED48U, 0x1E1170ACU, 0x6C5A724EU,
+    0xFD0EFFFBU, 0x0F853856U, 0x3DAED51EU, 0x362D3927U,
+    0x0A0FD964U, 0x685CA621U, 0x9B5B54D1U, 0x24362E3AU,
+    0x0C0A67B1U, 0x9357E70FU, 0xB4EE96D2U, 0x1B9B919EU,
+    0x80C0C54FU, 0x61DC20A2U, 0x5A774B69U, 0x1C121A16U,
+    0xE293BA0AU, 0xC0A02AE5U, 0x3C22E043U, 0x121B171DU,
+    0x0E090D0BU, 0xF28BC7ADU, 0x2DB6A8B9U, 0x141EA9C8U,
+    0x57F11985U, 0xAF75074CU, 0xEE99DDBBU, 0xA37F60FDU,
+    0xF701269FU, 0x5C72F5BCU, 0x44663BC5U, 0x5BFB7E34U,
+    0x8B432976U, 0xCB23C6DCU, 0xB6EDFC68U, 0xB8E4F163U,
+    0xD731DCCAU, 0x42638510U, 0x13972240U, 0x84C61120U,
+    0x854A247DU, 0xD2BB3DF8U, 0xAEF93211U, 0xC729A16DU,
+    0x1D9E2F4BU, 0xDCB230F3U, 0x0D8652ECU, 0x77C1E3D0U,
+    0x2BB3166CU, 0xA970B999U, 0x119448FAU, 0x47E96422U,
+    0xA8FC8CC4U, 0xA0F03F1AU, 0x567D2CD8U, 0x223390EFU,
+    0x87494EC7U, 0xD938D1C1U, 0x8CCAA2FEU, 0x98D40B36U,
+    0xA6F581CFU, 0xA57ADE28U, 0xDAB78E26U, 0x3FADBFA4U,
+    0x2C3A9DE4U, 0x5078920DU, 0x6A5FCC9BU, 0x547E4662U,
+    0xF68D13C2U, 0x90D8B8E8U, 0x2E39F75EU, 0x82C3AFF5U,
+    0x9F5D80BEU, 0x69D0937CU, 0x6FD52DA9U, 0xCF2512B3U,
+    0xC8AC993BU, 0x10187DA7U, 0xE89C636EU, 0xDB3BBB7BU,
+    0xCD267809U, 0x6E5918F4U, 0xEC9AB701U, 0x834F9AA8U,
+    0xE6956E65U, 0xAAFFE67EU, 0x21BCCF08U, 0xEF15E8E6U,
+    0xBAE79BD9U, 0x4A6F36CEU, 0xEA9F09D4U, 0x29B07CD6U,
+    0x31A4B2AFU, 0x2A3F2331U, 0xC6A59430U, 0x35A266C0U,
+    0x744EBC37U, 0xFC82CAA6U, 0xE090D0B0U, 0x33A7D815U,
+    0xF104984AU, 0x41ECDAF7U, 0x7FCD500EU, 0x1791F62FU,
+    0x764DD68DU, 0x43EFB04DU, 0xCCAA4D54U, 0xE49604DFU,
+    0x9ED1B5E3U, 0x4C6A881BU, 0xC12C1FB8U, 0x4665517FU,
+    0x9D5EEA04U, 0x018C355DU, 0xFA877473U, 0xFB0B412EU,
+    0xB3671D5AU, 0x92DBD252U, 0xE9105633U, 0x6DD64713U,
+    0x9AD7618CU, 0x37A10C7AU, 0x59F8148EU, 0xEB133C89U,
+    0xCEA927EEU, 0xB761C935U, 0xE11CE5EDU, 0x7A47B13CU,
+    0x9CD2DF59U, 0x55F2733FU, 0x1814CE79U, 0x73C737BFU,
+    0x53F7CDEAU, 0x5FFDAA5BU, 0xDF3D6F14U, 0x7844DB86U,
+    0xCAAFF381U, 0xB968C43EU, 0x3824342CU, 0xC2A3405FU,
+    0x161DC372U, 0xBCE2250CU, 0x283C498BU, 0xFF0D9541U,
+    0x39A80171U, 0x080CB3DEU, 0xD8B4E49CU, 0x6456C190U,
+    0x7BCB8461U, 0xD532B670U, 0x486C5C74U, 0xD0B85742U
+};
+
+static const uint32_t Td1[256] = {
+    0x5051F4A7U, 0x537E4165U, 0xC31A17A4U, 0x963A275EU,
+    0xCB3BAB6BU, 0xF11F9D45U, 0xABACFA58U, 0x934BE303U,
+    0x552030FAU, 0xF6AD766DU, 0x9188CC76U, 0x25F5024CU,
+    0xFC4FE5D7U, 0xD7C52ACBU, 0x80263544U, 0x8FB562A3U,
+    0x49DEB15AU, 0x6725BA1BU, 0x9845EA0EU, 0xE15DFEC0U,
+    0x02C32F75U, 0x12814CF0U, 0xA38D4697U, 0xC66BD3F9U,
+    0xE7038F5FU, 0x9515929CU, 0xEBBF6D7AU, 0xDA955259U,
+    0x2DD4BE83U, 0xD3587421U, 0x2949E069U, 0x448EC9C8U,
+    0x6A75C289U, 0x78F48E79U, 0x6B99583EU, 0xDD27B971U,
+    0xB6BEE14FU, 0x17F088ADU, 0x66C920ACU, 0xB47DCE3AU,
+    0x1863DF4AU, 0x82E51A31U, 0x60975133U, 0x4562537FU,
+    0xE0B16477U, 0x84BB6BAEU, 0x1CFE81A0U, 0x94F9082BU,
+    0x58704868U, 0x198F45FDU, 0x8794DE6CU, 0xB7527BF8U,
+    0x23AB73D3U, 0xE2724B02U, 0x57E31F8FU, 0x2A6655ABU,
+    0x07B2EB28U, 0x032FB5C2U, 0x9A86C57BU, 0xA5D33708U,
+    0xF2302887U, 0xB223BFA5U, 0xBA02036AU, 0x5CED1682U,
+    0x2B8ACF1CU, 0x92A779B4U, 0xF0F307F2U, 0xA14E69E2U,
+    0xCD65DAF4U, 0xD50605BEU, 0x1FD13462U, 0x8AC4A6FEU,
+    0x9D342E53U, 0xA0A2F355U, 0x32058AE1U, 0x75A4F6EBU,
+    0x390B83ECU, 0xAA4060EFU, 0x065E719FU, 0x51BD6E10U,
+    0xF93E218AU, 0x3D96DD06U, 0xAEDD3E05U, 0x464DE6BDU,
+    0xB591548DU, 0x0571C45DU, 0x6F0406D4U, 0xFF605015U,
+    0x241998FBU, 0x97D6BDE9U, 0xCC894043U, 0x7767D99EU,
+    0xBDB0E842U, 0x8807898BU, 0x38E7195BU, 0xDB79C8EEU,
+    0x47A17C0AU, 0xE97C420FU, 0xC9F8841EU, 0x00000000U,
+    0x83098086U, 0x48322BEDU, 0xAC1E1170U, 0x4E6C5A72U,
+    0xFBFD0EFFU, 0x560F8538U, 0x1E3DAED5U, 0x27362D39U,
+    0x640A0FD9U, 0x21685CA6U, 0xD19B5B54U, 0x3A24362EU,
+    0xB10C0A67U, 0x0F9357E7U, 0xD2B4EE96U, 0x9E1B9B91U,
+    0x4F80C0C5U, 0xA261DC20U, 0x695A774BU, 0x161C121AU,
+    0x0AE293BAU, 0xE5C0A02AU, 0x433C22E0U, 0x1D121B17U,
+    0x0B0E090DU, 0xADF28BC7U, 0xB92DB6A8U, 0xC8141EA9U,
+    0x8557F119U, 0x4CAF7507U, 0xBBEE99DDU, 0xFDA37F60U,
+    0x9FF70126U, 0xBC5C72F5U, 0xC544663BU, 0x345BFB7EU,
+    0x768B4329U, 0xDCCB23C6U, 0x68B6EDFCU, 0x63B8E4F1U,
+    0xCAD731DCU, 0x10426385U, 0x40139722U, 0x2084C611U,
+    0x7D854A24U, 0xF8D2BB3DU, 0x11AEF932U, 0x6DC729A1U,
+    0x4B1D9E2FU, 0xF3DCB230U, 0xEC0D8652U, 0xD077C1E3U,
+    0x6C2BB316U, 0x99A970B9U, 0xFA119448U, 0x2247E964U,
+    0xC4A8FC8CU, 0x1AA0F03FU, 0xD8567D2CU, 0xEF223390U,
+    0xC787494EU, 0xC1D938D1U, 0xFE8CCAA2U, 0x3698D40BU,
+    0xCFA6F581U, 0x28A57ADEU, 0x26DAB78EU, 0xA43FADBFU,
+    0xE42C3A9DU, 0x0D507892U, 0x9B6A5FCCU, 0x62547E46U,
+    0xC2F68D13U, 0xE890D8B8U, 0x5E2E39F7U, 0xF582C3AFU,
+    0xBE9F5D80U, 0x7C69D093U, 0xA96FD52DU, 0xB3CF2512U,
+    0x3BC8AC99U, 0xA710187DU, 0x6EE89C63U, 0x7BDB3BBBU,
+    0x09CD2678U, 0xF46E5918U, 0x01EC9AB7U, 0xA8834F9AU,
+    0x65E6956EU, 0x7EAAFFE6U, 0x0821BCCFU, 0xE6EF15E8U,
+    0xD9BAE79BU, 0xCE4A6F36U, 0xD4EA9F09U, 0xD629B07CU,
+    0xAF31A4B2U, 0x312A3F23U, 0x30C6A594U, 0xC035A266U,
+    0x37744EBCU, 0xA6FC82CAU, 0xB0E090D0U, 0x1533A7D8U,
+    0x4AF10498U, 0xF741ECDAU, 0x0E7FCD50U, 0x2F1791F6U,
+    0x8D764DD6U, 0x4D43EFB0U, 0x54CCAA4DU, 0xDFE49604U,
+    0xE39ED1B5U, 0x1B4C6A88U, 0xB8C12C1FU, 0x7F466551U,
+    0x049D5EEAU, 0x5D018C35U, 0x73FA8774U, 0x2EFB0B41U,
+    0x5AB3671DU, 0x5292DBD2U, 0x33E91056U, 0x136DD647U,
+    0x8C9AD761U, 0x7A37A10CU, 0x8E59F814U, 0x89EB133CU,
+    0xEECEA927U, 0x35B761C9U, 0xEDE11CE5U, 0x3C7A47B1U,
+    0x599CD2DFU, 0x3F55F273U, 0x791814CEU, 0xBF73C737U,
+    0xEA53F7CDU, 0x5B5FFDAAU, 0x14DF3D6FU, 0x867844DBU,
+    0x81CAAFF3U, 0x3EB968C4U, 0x2C382434U, 0x5FC2A340U,
+    0x72161DC3U, 0x0CBCE225U, 0x8B283C49U, 0x41FF0D95U,
+    0x7139A801U, 0xDE080CB3U, 0x9CD8B4E4U, 0x906456C1U,
+    0x617BCB84U, 0x70D532B6U, 0x74486C5CU, 0x42D0B857U
+};
+
+static const uint32_t Td2[256] = {
+    0xA75051F4U, 0x65537E41U, 0xA4C31A17U, 0x5E963A27U,
+    0x6BCB3BABU, 0x45F11F9DU, 0x58ABACFAU, 0x03934BE3U,
+    0xFA552030U, 0x6DF6AD76U, 0x769188CCU, 0x4C25F502U,
+    0xD7FC4FE5U, 0xCBD7C52AU, 0x44802635U, 0xA38FB562U,
+    0x5A49DEB1U, 0x1B6725BAU, 0x0E9845EAU, 0xC0E15DFEU,
+    0x7502C32FU, 0xF012814CU, 0x97A38D46U, 0xF9C66BD3U,
+    0x5FE7038FU, 0x9C951592U, 0x7AEBBF6DU, 0x59DA9552U,
+    0x832DD4BEU, 0x21D35874U, 0x692949E0U, 0xC8448EC9U,
+    0x896A75C2U, 0x7978F48EU, 0x3E6B9958U, 0x71DD27B9U,
+    0x4FB6BEE1U, 0xAD17F088U, 0xAC66C920U, 0x3AB47DCEU,
+    0x4A1863DFU, 0x3182E51AU, 0x33609751U, 0x7F456253U,
+    0x77E0B164U, 0xAE84BB6BU, 0xA01CFE81U, 0x2B94F908U,
+    0x68587048U, 0xFD198F45U, 0x6C8794DEU, 0xF8B7527BU,
+    0xD323AB73U, 0x02E2724BU, 0x8F57E31FU, 0xAB2A6655U,
+    0x2807B2EBU, 0xC2032FB5U, 0x7B9A86C5U, 0x08A5D337U,
+    0x87F23028U, 0xA5B223BFU, 0x6ABA0203U, 0x825CED16U,
+    0x1C2B8ACFU, 0xB492A779U, 0xF2F0F307U, 0xE2A14E69U,
+    0xF4CD65DAU, 0xBED50605U, 0x621FD134U, 0xFE8AC4A6U,
+    0x539D342EU, 0x55A0A2F3U, 0xE132058AU, 0xEB75A4F6U,
+    0xEC390B83U, 0xEFAA4060U, 0x9F065E71U, 0x1051BD6EU,
+    0x8AF93E21U, 0x063D96DDU, 0x05AEDD3EU, 0xBD464DE6U,
+    0x8DB59154U, 0x5D0571C4U, 0xD46F0406U, 0x15FF6050U,
+    0xFB241998U, 0xE997D6BDU, 0x43CC8940U, 0x9E7767D9U,
+    0x42BDB0E8U, 0x8B880789U, 0x5B38E719U, 0xEEDB79C8U,
+    0x0A47A17CU, 0x0FE97C42U, 0x1EC9F884U, 0x00000000U,
+    0x86830980U, 0xED48322BU, 0x70AC1E11U, 0x724E6C5AU,
+    0xFFFBFD0EU, 0x38560F85U, 0xD51E3DAEU, 0x3927362DU,
+    0xD9640A0FU, 0xA621685CU, 0x54D19B5BU, 0x2E3A2436U,
+    0x67B10C0AU, 0xE70F9357U, 0x96D2B4EEU, 0x919E1B9BU,
+    0xC54F80C0U, 0x20A261DCU, 0x4B695A77U, 0x1A161C12U,
+    0xBA0AE293U, 0x2AE5C0A0U, 0xE0433C22U, 0x171D121BU,
+    0x0D0B0E09U, 0xC7ADF28BU, 0xA8B92DB6U, 0xA9C8141EU,
+    0x198557F1U, 0x074CAF75U, 0xDDBBEE99U, 0x60FDA37FU,
+    0x269FF701U, 0xF5BC5C72U, 0x3BC54466U, 0x7E345BFBU,
+    0x29768B43U, 0xC6DCCB23U, 0xFC68B6EDU, 0xF163B8E4U,
+    0xDCCAD731U, 0x85104263U, 0x22401397U, 0x112084C6U,
+    0x247D854AU, 0x3DF8D2BBU, 0x3211AEF9U, 0xA16DC729U,
+    0x2F4B1D9EU, 0x30F3DCB2U, 0x52EC0D86U, 0xE3D077C1U,
+    0x166C2BB3U, 0xB999A970U, 0x48FA1194U, 0x642247E9U,
+    0x8CC4A8FCU, 0x3F1AA0F0U, 0x2CD8567DU, 0x90EF2233U,
+    0x4EC78749U, 0xD1C1D938U, 0xA2FE8CCAU, 0x0B3698D4U,
+    0x81CFA6F5U, 0xDE28A57AU, 0x8E26DAB7U, 0xBFA43FADU,
+    0x9DE42C3AU, 0x920D5078U, 0xCC9B6A5FU, 0x4662547EU,
+    0x13C2F68DU, 0xB8E890D8U, 0xF75E2E39U, 0xAFF582C3U,
+    0x80BE9F5DU, 0x937C69D0U, 0x2DA96FD5U, 0x12B3CF25U,
+    0x993BC8ACU, 0x7DA71018U, 0x636EE89CU, 0xBB7BDB3BU,
+    0x7809CD26U, 0x18F46E59U, 0xB701EC9AU, 0x9AA8834FU,
+    0x6E65E695U, 0xE67EAAFFU, 0xCF0821BCU, 0xE8E6EF15U,
+    0x9BD9BAE7U, 0x36CE4A6FU, 0x09D4EA9FU, 0x7CD629B0U,
+    0xB2AF31A4U, 0x23312A3FU, 0x9430C6A5U, 0x66C035A2U,
+    0xBC37744EU, 0xCAA6FC82U, 0xD0B0E090U, 0xD81533A7U,
+    0x984AF104U, 0xDAF741ECU, 0x500E7FCDU, 0xF62F1791U,
+    0xD68D764DU, 0xB04D43EFU, 0x4D54CCAAU, 0x04DFE496U,
+    0xB5E39ED1U, 0x881B4C6AU, 0x1FB8C12CU, 0x517F4665U,
+    0xEA049D5EU, 0x355D018CU, 0x7473FA87U, 0x412EFB0BU,
+    0x1D5AB367U, 0xD25292DBU, 0x5633E910U, 0x47136DD6U,
+    0x618C9AD7U, 0x0C7A37A1U, 0x148E59F8U, 0x3C89EB13U,
+    0x27EECEA9U, 0xC935B761U, 0xE5EDE11CU, 0xB13C7A47U,
+    0xDF599CD2U, 0x733F55F2U, 0xCE791814U, 0x37BF73C7U,
+    0xCDEA53F7U, 0xAA5B5FFDU, 0x6F14DF3DU, 0xDB867844U,
+    0xF381CAAFU, 0xC43EB968U, 0x342C3824U, 0x405FC2A3U,
+    0xC372161DU, 0x250CBCE2U, 0x498B283CU, 0x9541FF0DU,
+    0x017139A8U, 0xB3DE080CU, 0xE49CD8B4U, 0xC1906456U,
+    0x84617BCBU, 0xB670D532U, 0x5C74486CU, 0x5742D0B8U
+};
+
+static const uint32_t Td3[256] = {
+    0xF4A75051U, 0x4165537EU, 0x17A4C31AU, 0x275E963AU,
+    0xAB6BCB3BU, 0x9D45F11FU, 0xFA58ABACU, 0xE303934BU,
+    0x30FA5520U, 0x766DF6ADU, 0xCC769188U, 0x024C25F5U,
+    0xE5D7FC4FU, 0x2ACBD7C5U, 0x35448026U, 0x62A38FB5U,
+    0xB15A49DEU, 0xBA1B6725U, 0xEA0E9845U, 0xFEC0E15DU,
+    0x2F7502C3U, 0x4CF01281U, 0x4697A38DU, 0xD3F9C66BU,
+    0x8F5FE703U, 0x929C9515U, 0x6D7AEBBFU, 0x5259DA95U,
+    0xBE832DD4U, 0x7421D358U, 0xE0692949U, 0xC9C8448EU,
+    0xC2896A75U, 0x8E7978F4U, 0x583E6B99U, 0xB971DD27U,
+    0xE14FB6BEU, 0x88AD17F0U, 0x20AC66C9U, 0xCE3AB47DU,
+    0xDF4A1863U, 0x1A3182E5U, 0x51336097U, 0x537F4562U,
+    0x6477E0B1U, 0x6BAE84BBU, 0x81A01CFEU, 0x082B94F9U,
+    0x48685870U, 0x45FD198FU, 0xDE6C8794U, 0x7BF8B752U,
+    0x73D323ABU, 0x4B02E272U, 0x1F8F57E3U, 0x55AB2A66U,
+    0xEB2807B2U, 0xB5C2032FU, 0xC57B9A86U, 0x3708A5D3U,
+    0x2887F230U, 0xBFA5B223U, 0x036ABA02U, 0x16825CEDU,
+    0xCF1C2B8AU, 0x79B492A7U, 0x07F2F0F3U, 0x69E2A14EU,
+    0xDAF4CD65U, 0x05BED506U, 0x34621FD1U, 0xA6FE8AC4U,
+    0x2E539D34U, 0xF355A0A2U, 0x8AE13205U, 0xF6EB75A4U,
+    0x83EC390BU, 0x60EFAA40U, 0x719F065EU, 0x6E1051BDU,
+    0x218AF93EU, 0xDD063D96U, 0x3E05AEDDU, 0xE6BD464DU,
+    0x548DB591U, 0xC45D0571U, 0x06D46F04U, 0x5015FF60U,
+    0x98FB2419U, 0xBDE997D6U, 0x4043CC89U, 0xD99E7767U,
+    0xE842BDB0U, 0x898B8807U, 0x195B38E7U, 0xC8EEDB79U,
+    0x7C0A47A1U, 0x420FE97CU, 0x841EC9F8U, 0x00000000U,
+    0x80868309U, 0x2BED4832U, 0x1170AC1EU, 0x5A724E6CU,
+    0x0EFFFBFDU, 0x8538560FU, 0xAED51E3DU, 0x2D392736U,
+    0x0FD9640AU, 0x5CA62168U, 0x5B54D19BU, 0x362E3A24U,
+    0x0A67B10CU, 0x57E70F93U, 0xEE96D2B4U, 0x9B919E1BU,
+    0xC0C54F80U, 0xDC20A261U, 0x774B695AU, 0x121A161CU,
+    0x93BA0AE2U, 0xA02AE5C0U, 0x22E0433CU, 0x1B171D12U,
+    0x090D0B0EU, 0x8BC7ADF2U, 0xB6A8B92DU, 0x1EA9C814U,
+    0xF1198557U, 0x75074CAFU, 0x99DDBBEEU, 0x7F60FDA3U,
+    0x01269FF7U, 0x72F5BC5CU, 0x663BC544U, 0xFB7E345BU,
+    0x4329768BU, 0x23C6DCCBU, 0xEDFC68B6U, 0xE4F163B8U,
+    0x31DCCAD7U, 0x63851042U, 0x97224013U, 0xC6112084U,
+    0x4A247D85U, 0xBB3DF8D2U, 0xF93211AEU, 0x29A16DC7U,
+    0x9E2F4B1DU, 0xB230F3DCU, 0x8652EC0DU, 0xC1E3D077U,
+    0xB3166C2BU, 0x70B999A9U, 0x9448FA11U, 0xE9642247U,
+    0xFC8CC4A8U, 0xF03F1AA0U, 0x7D2CD856U, 0x3390EF22U,
+    0x494EC787U, 0x38D1C1D9U, 0xCAA2FE8CU, 0xD40B3698U,
+    0xF581CFA6U, 0x7ADE28A5U, 0xB78E26DAU, 0xADBFA43FU,
+    0x3A9DE42CU, 0x78920D50U, 0x5FCC9B6AU, 0x7E466254U,
+    0x8D13C2F6U, 0xD8B8E890U, 0x39F75E2EU, 0xC3AFF582U,
+    0x5D80BE9FU, 0xD0937C69U, 0xD52DA96FU, 0x2512B3CFU,
+    0xAC993BC8U, 0x187DA710U, 0x9C636EE8U, 0x3BBB7BDBU,
+    0x267809CDU, 0x5918F46EU, 0x9AB701ECU, 0x4F9AA883U,
+    0x956E65E6U, 0xFFE67EAAU, 0xBCCF0821U, 0x15E8E6EFU,
+    0xE79BD9BAU, 0x6F36CE4AU, 0x9F09D4EAU, 0xB07CD629U,
+    0xA4B2AF31U, 0x3F23312AU, 0xA59430C6U, 0xA266C035U,
+    0x4EBC3774U, 0x82CAA6FCU, 0x90D0B0E0U, 0xA7D81533U,
+    0x04984AF1U, 0xECDAF741U, 0xCD500E7FU, 0x91F62F17U,
+    0x4DD68D76U, 0xEFB04D43U, 0xAA4D54CCU, 0x9604DFE4U,
+    0xD1B5E39EU, 0x6A881B4CU, 0x2C1FB8C1U, 0x65517F46U,
+    0x5EEA049DU, 0x8C355D01U, 0x877473FAU, 0x0B412EFBU,
+    0x671D5AB3U, 0xDBD25292U, 0x105633E9U, 0xD647136DU,
+    0xD7618C9AU, 0xA10C7A37U, 0xF8148E59U, 0x133C89EBU,
+    0xA927EECEU, 0x61C935B7U, 0x1CE5EDE1U, 0x47B13C7AU,
+    0xD2DF599CU, 0xF2733F55U, 0x14CE7918U, 0xC737BF73U,
+    0xF7CDEA53U, 0xFDAA5B5FU, 0x3D6F14DFU, 0x44DB8678U,
+    0xAFF381CAU, 0x68C43EB9U, 0x24342C38U, 0xA3405FC2U,
+    0x1DC37216U, 0xE2250CBCU, 0x3C498B28U, 0x0D9541FFU,
+    0xA8017139U, 0x0CB3DE08U, 0xB4E49CD8U, 0x56C19064U,
+    0xCB84617BU, 0x32B670D5U, 0x6C5C7448U, 0xB85742D0U
+};
+
+static const uint8_t Td4[256] = {
+    0x52, 0x09, 0x6A, 0xD5, 0x30, 0x36, 0xA5, 0x38,
+    0xBF, 0x40, 0xA3, 0x9E, 0x81, 0xF3, 0xD7, 0xFB,
+    0x7C, 0xE3, 0x39, 0x82, 0x9B, 0x2F, 0xFF, 0x87,
+    0x34, 0x8E, 0x43, 0x44, 0xC4, 0xDE, 0xE9, 0xCB,
+    0x54, 0x7B, 0x94, 0x32, 0xA6, 0xC2, 0x23, 0x3D,
+    0xEE, 0x4C, 0x95, 0x0B, 0x42, 0xFA, 0xC3, 0x4E,
+    0x08, 0x2E, 0xA1, 0x66, 0x28, 0xD9, 0x24, 0xB2,
+    0x76, 0x5B, 0xA2, 0x49, 0x6D, 0x8B, 0xD1, 0x25,
+    0x72, 0xF8, 0xF6, 0x64, 0x86, 0x68, 0x98, 0x16,
+    0xD4, 0xA4, 0x5C, 0xCC, 0x5D, 0x65, 0xB6, 0x92,
+    0x6C, 0x70, 0x48, 0x50, 0xFD, 0xED, 0xB9, 0xDA,
+    0x5E, 0x15, 0x46, 0x57, 0xA7, 0x8D, 0x9D, 0x84,
+    0x90, 0xD8, 0xAB, 0x00, 0x8C, 0xBC, 0xD3, 0x0A,
+    0xF7, 0xE4, 0x58, 0x05, 0xB8, 0xB3, 0x45, 0x06,
+    0xD0, 0x2C, 0x1E, 0x8F, 0xCA, 0x3F, 0x0F, 0x02,
+    0xC1, 0xAF, 0xBD, 0x03, 0x01, 0x13, 0x8A, 0x6B,
+    0x3A, 0x91, 0x11, 0x41, 0x4F, 0x67, 0xDC, 0xEA,
+    0x97, 0xF2, 0xCF, 0xCE, 0xF0, 0xB4, 0xE6, 0x73,
+    0x96, 0xAC, 0x74, 0x22, 0xE7, 0xAD, 0x35, 0x85,
+    0xE2, 0xF9, 0x37, 0xE8, 0x1C, 0x75, 0xDF, 0x6E,
+    0x47, 0xF1, 0x1A, 0x71, 0x1D, 0x29, 0xC5, 0x89,
+    0x6F, 0xB7, 0x62, 0x0E, 0xAA, 0x18, 0xBE, 0x1B,
+    0xFC, 0x56, 0x3E, 0x4B, 0xC6, 0xD2, 0x79, 0x20,
+    0x9A, 0xDB, 0xC0, 0xFE, 0x78, 0xCD, 0x5A, 0xF4,
+    0x1F, 0xDD, 0xA8, 0x33, 0x88, 0x07, 0xC7, 0x31,
+    0xB1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xEC, 0x5F,
+    0x60, 0x51, 0x7F, 0xA9, 0x19, 0xB5, 0x4A, 0x0D,
+    0x2D, 0xE5, 0x7A, 0x9F, 0x93, 0xC9, 0x9C, 0xEF,
+    0xA0, 0xE0, 0x3B, 0x4D, 0xAE, 0x2A, 0xF5, 0xB0,
+    0xC8, 0xEB, 0xBB, 0x3C, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2B, 0x04, 0x7E, 0xBA, 0x77, 0xD6, 0x26,
+    0xE1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0C, 0x7D
+};
+
+/*
+ * xtime multiplies each of the four bytes packed in a word by 2 in GF(2^8).
+ */
+static uint32_t xtime(uint32_t w) {
+    return ((w & 0x7f7f7f7fU) << 1) ^ (((w >> 7) & 0x01010101U) * 0x1b);
+}
+
+#define ROTR8(w)  (((w) >> 8) | ((w) << 24))
+#define ROTR16(w) (((w) >> 16) | ((w) << 16))
+
+/*
+ * InvMixColumn applies InvMixColumns to one column. The inverse matrix
+ * factors as MixColumns(a ^ 4*(a ^ a<<<2)), where <<<2 rotates by two rows,
+ * so it needs no multiplication tables and runs in constant time.
+ */
+static uint32_t InvMixColumn(uint32_t a) {
+    const uint32_t u = xtime(xtime(a ^ ROTR16(a)));
+    const uint32_t v = a ^ u;
+    const uint32_t t = v ^ ROTR8(v);
+
+    return xtime(t) ^ ROTR8(v) ^ ROTR16(t);
+}
+
+/*
+ * aes128d_block_table performs AES-128 decryption on a single 16-byte block
+ * with the Td tables.
+ */
+void aes128d_block_table(const aes128d_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    const uint8_t* rk = ctx->RoundKey;
+    uint32_t s0, s1, s2, s3, t0, t1, t2, t3;
+
+    s0 = GETU32(input)      ^ GETU32(rk);
+    s1 = GETU32(input + 4)  ^ GETU32(rk + 4);
+    s2 = GETU32(input + 8)  ^ GETU32(rk + 8);
+    s3 = GETU32(input + 12) ^ GETU32(rk + 12);
+
+    for (int round = 1; round < 10; ++round) {
+        rk += 16;
+        t0 = Td0[s0 >> 24] ^ Td1[(s3 >> 16) & 0xff] ^ Td2[(s2 >> 8) & 0xff] ^ Td3[s1 & 0xff] ^ GETU32(rk);
+        t1 = Td0[s1 >> 24] ^ Td1[(s0 >> 16) & 0xff] ^ Td2[(s3 >> 8) & 0xff] ^ Td3[s2 & 0xff] ^ GETU32(rk + 4);
+        t2 = Td0[s2 >> 24] ^ Td1[(s1 >> 16) & 0xff] ^ Td2[(s0 >> 8) & 0xff] ^ Td3[s3 & 0xff] ^ GETU32(rk + 8);
+        t3 = Td0[s3 >> 24] ^ Td1[(s2 >> 16) & 0xff] ^ Td2[(s1 >> 8) & 0xff] ^ Td3[s0 & 0xff] ^ GETU32(rk + 12);
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    // Final round: InvSubBytes and InvShiftRows only
+    rk += 16;
+    t0 = ((uint32_t)Td4[s0 >> 24] << 24) ^ ((uint32_t)Td4[(s3 >> 16) & 0xff] << 16) ^
+         ((uint32_t)Td4[(s2 >> 8) & 0xff] << 8) ^ (uint32_t)Td4[s1 & 0xff] ^ GETU32(rk);
+    t1 = ((uint32_t)Td4[s1 >> 24] << 24) ^ ((uint32_t)Td4[(s0 >> 16) & 0xff] << 16) ^
+         ((uint32_t)Td4[(s3 >> 8) & 0xff] << 8) ^ (uint32_t)Td4[s2 & 0xff] ^ GETU32(rk + 4);
+    t2 = ((uint32_t)Td4[s2 >> 24] << 24) ^ ((uint32_t)Td4[(s1 >> 16) & 0xff] << 16) ^
+         ((uint32_t)Td4[(s0 >> 8) & 0xff] << 8) ^ (uint32_t)Td4[s3 & 0xff] ^ GETU32(rk + 8);
+    t3 = ((uint32_t)Td4[s3 >> 24] << 24) ^ ((uint32_t)Td4[(s2 >> 16) & 0xff] << 16) ^
+         ((uint32_t)Td4[(s1 >> 8) & 0xff] << 8) ^ (uint32_t)Td4[s0 & 0xff] ^ GETU32(rk + 12);
+
+    PUTU32(output,      t0);
+    PUTU32(output + 4,  t1);
+    PUTU32(output + 8,  t2);
+    PUTU32(output + 12, t3);
+}
+
+/*
+ * aes128d_blocks_table decrypts four blocks per pass with their rounds
+ * interleaved, like aes128e_blocks_ttable does for encryption.
+ */
+void aes128d_blocks_table(const aes128d_ctx* ctx, uint8_t* output,
+                          const uint8_t* input, size_t nblocks) {
+    uint32_t rk[44];
+    uint32_t s[4][4], t[4][4];
+
+    for (int i = 0; i < 44; ++i) {
+        rk[i] = GETU32(ctx->RoundKey + 4 * i);
+    }
+
+    for (; nblocks >= 4; nblocks -= 4, input += 64, output += 64) {
+        for (int b = 0; b < 4; ++b) {
+            for (int c = 0; c < 4; ++c) {
+                s[b][c] = GETU32(input + 16 * b + 4 * c) ^ rk[c];
+            }
+        }
+
+        for (int round = 1; round < 10; ++round) {
+            const uint32_t* k = rk + 4 * round;
+            for (int b = 0; b < 4; ++b) {
+                for (int c = 0; c < 4; ++c) {
+                    t[b][c] = Td0[s[b][c] >> 24] ^ Td1[(s[b][(c + 3) & 3] >> 16) & 0xff] ^
+                              Td2[(s[b][(c + 2) & 3] >> 8) & 0xff] ^ Td3[s[b][(c + 1) & 3] & 0xff] ^ k[c];
+                }
+            }
+            memcpy(s, t, sizeof(s));
+        }
+
+        for (int b = 0; b < 4; ++b) {
+            for (int c = 0; c < 4; ++c) {
+                t[b][c] = ((uint32_t)Td4[s[b][c] >> 24] << 24) ^ ((uint32_t)Td4[(s[b][(c + 3) & 3] >> 16) & 0xff] << 16) ^
+                          ((uint32_t)Td4[(s[b][(c + 2) & 3] >> 8) & 0xff] << 8) ^ (uint32_t)Td4[s[b][(c + 1) & 3] & 0xff] ^
+                          rk[40 + c];
+                PUTU32(output + 16 * b + 4 * c, t[b][c]);
+            }
+        }
+    }
+
+    for (; nblocks > 0; --nblocks, input += 16, output += 16) {
+        aes128d_block_table(ctx, output, input);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <wmmintrin.h>
+
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+
+/*
+ * aes128d_block_aesni decrypts one block with AESDEC/AESDECLAST, which take
+ * their round keys in the equivalent-inverse form produced by aes128d_init.
+ */
+AESNI_TARGET void aes128d_block_aesni(const aes128d_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    const __m128i* rk = (const __m128i*) ctx->RoundKey;
+    __m128i state = _mm_xor_si128(_mm_loadu_si128((const __m128i*) input), _mm_loadu_si128(rk));
+
+    for (int round = 1; round < 10; ++round) {
+        state = _mm_aesdec_si128(state, _mm_loadu_si128(rk + round));
+    }
+    _mm_storeu_si128((__m128i*) output, _mm_aesdeclast_si128(state, _mm_loadu_si128(rk + 10)));
+}
+
+/*
+ * aes128d_blocks_aesni decrypts eight blocks per pass, issuing the same round
+ * for all of them back to back to keep the AES unit busy.
+ */
+AESNI_TARGET void aes128d_blocks_aesni(const aes128d_ctx* ctx, uint8_t* output,
+                                       const uint8_t* input, size_t nblocks) {
+    const __m128i* in = (const __m128i*) input;
+    __m128i* out = (__m128i*) output;
+    __m128i rk[11];
+    __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+    for (int i = 0; i < 11; ++i) {
+        rk[i] = _mm_loadu_si128((const __m128i*) ctx->RoundKey + i);
+    }
+
+    for (; nblocks >= 8; nblocks -= 8, in += 8, out += 8) {
+        b0 = _mm_xor_si128(_mm_loadu_si128(in + 0), rk[0]);
+        b1 = _mm_xor_si128(_mm_loadu_si128(in + 1), rk[0]);
+        b2 = _mm_xor_si128(_mm_loadu_si128(in + 2), rk[0]);
+        b3 = _mm_xor_si128(_mm_loadu_si128(in + 3), rk[0]);
+        b4 = _mm_xor_si128(_mm_loadu_si128(in + 4), rk[0]);
+        b5 = _mm_xor_si128(_mm_loadu_si128(in + 5), rk[0]);
+        b6 = _mm_xor_si128(_mm_loadu_si128(in + 6), rk[0]);
+        b7 = _mm_xor_si128(_mm_loadu_si128(in + 7), rk[0]);
+
+        for (int round = 1; round < 10; ++round) {
+            b0 = _mm_aesdec_si128(b0, rk[round]);
+            b1 = _mm_aesdec_si128(b1, rk[round]);
+            b2 = _mm_aesdec_si128(b2, rk[round]);
+            b3 = _mm_aesdec_si128(b3, rk[round]);
+            b4 = _mm_aesdec_si128(b4, rk[round]);
+            b5 = _mm_aesdec_si128(b5, rk[round]);
+            b6 = _mm_aesdec_si128(b6, rk[round]);
+            b7 = _mm_aesdec_si128(b7, rk[round]);
+        }
+
+        _mm_storeu_si128(out + 0, _mm_aesdeclast_si128(b0, rk[10]));
+        _mm_storeu_si128(out + 1, _mm_aesdeclast_si128(b1, rk[10]));
+        _mm_storeu_si128(out + 2, _mm_aesdeclast_si128(b2, rk[10]));
+        _mm_storeu_si128(out + 3, _mm_aesdeclast_si128(b3, rk[10]));
+        _mm_storeu_si128(out + 4, _mm_aesdeclast_si128(b4, rk[10]));
+        _mm_storeu_si128(out + 5, _mm_aesdeclast_si128(b5, rk[10]));
+        _mm_storeu_si128(out + 6, _mm_aesdeclast_si128(b6, rk[10]));
+        _mm_storeu_si128(out + 7, _mm_aesdeclast_si128(b7, rk[10]));
+    }
+
+    for (; nblocks > 0; --nblocks, ++in, ++out) {
+        aes128d_block_aesni(ctx, (uint8_t*) out, (const uint8_t*) in);
+    }
+}
+
+#else // !x86
+
+// Never selected on this architecture; present so the engine table links.
+void aes128d_block_aesni(const aes128d_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    (void) ctx; (void) output; (void) input;
+}
+
+void aes128d_blocks_aesni(const aes128d_ctx* ctx, uint8_t* output,
+                          const uint8_t* input, size_t nblocks) {
+    (void) ctx; (void) output; (void) input; (void) nblocks;
+}
+
+#endif
+
+/*
+ * aes128d_init_from builds the equivalent inverse schedule: the encryption
+ * round keys in reverse order, with InvMixColumns applied to rounds 1 to 9.
+ */
+void aes128d_init_from(aes128d_ctx* ctx, const aes128_ctx* enc) {
+    memcpy(ctx->RoundKey, enc->RoundKey + 160, 16);
+    for (int round = 1; round < 10; ++round) {
+        const uint8_t* src = enc->RoundKey + 16 * (10 - round);
+        uint8_t* dst = ctx->RoundKey + 16 * round;
+        for (int c = 0; c < 4; ++c) {
+            // InvMixColumn works on columns with row r in bits 8r..8r+7
+            uint32_t w = (uint32_t)src[4 * c] | ((uint32_t)src[4 * c + 1] << 8) |
+                         ((uint32_t)src[4 * c + 2] << 16) | ((uint32_t)src[4 * c + 3] << 24);
+            w = InvMixColumn(w);
+            dst[4 * c]     = (uint8_t) w;
+            dst[4 * c + 1] = (uint8_t) (w >> 8);
+            dst[4 * c + 2] = (uint8_t) (w >> 16);
+            dst[4 * c + 3] = (uint8_t) (w >> 24);
+        }
+    }
+    memcpy(ctx->RoundKey + 160, enc->RoundKey, 16);
+}
+
+void aes128d_init(aes128d_ctx* ctx, const uint8_t* key) {
+    aes128_ctx enc;
+
+    aes128_init(&enc, key);
+    aes128d_init_from(ctx, &enc);
+}
+
+void aes128d(uint8_t* output, const uint8_t* input, const uint8_t* key) {
+    aes128d_ctx ctx;
+
+    aes128d_init(&ctx, key);
+    aes128d_block(&ctx, output, input);
+}
@@ -7,16 +7,32 @@
  *
  * The AES-128 algorithm operates on 128-bit blocks and uses a 128-bit key.
  * This implementation follows the standard AES specification with 10 rounds.
+ * The same round functions also provide AES-192 (12 rounds) and AES-256
+ * (14 rounds); each key size gets its own fully unrolled cipher.
  ********************************************************************************/
 
+#include <stdatomic.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "../include/aes128e.h"
+#include "../include/aes128d.h"
+#include "aes128e_impl.h"
 
 // AES constants
 #define Nb 4  // Number of columns (32-bit words) comprising the State. For AES, Nb = 4.
-#define Nk 4  // Number of 32-bit words comprising the Cipher Key. For AES-128, Nk = 4.
-#define Nr 10 // Number of rounds in AES Cipher. For AES-128, Nr = 10.
+
+// Number of 32-bit words in the Cipher Key (Nk) and of rounds (Nr) per key size
+#define AES128_NK 4
+#define AES128_NR 10
+#define AES192_NK 6
+#define AES192_NR 12
+#define AES256_NK 8
+#define AES256_NR 14
+
+// Forces inlining so that Cipher is specialised for a constant Nr
+#define ALWAYS_INLINE inline __attribute__((always_inline))
 
 /*
  * The substitution box (S-box) is a non-linear substitution table used in the SubBytes step.
@@ -69,9 +85,9 @@ static const uint8_t Rcon[11] = {
 
 /*
  * KeyExpansion generates the round keys from the original cipher key.
- * It expands the 128-bit key into a series of round keys for each encryption round.
+ * It expands an Nk-word key into Nr + 1 round keys, one for each encryption round.
  */
-static void KeyExpansion(uint8_t* RoundKey, const uint8_t* Key) {
+static void KeyExpansion(uint8_t* RoundKey, const uint8_t* Key, unsigned Nk, unsigned Nr) {
     unsigned i, j, k;
     uint8_t tempa[4];
 
@@ -99,6 +115,12 @@ static void KeyExpansion(uint8_t* RoundKey, const uint8_t* Key) {
             tempa[1] = sbox[tempa[2]];
             tempa[2] = sbox[tempa[3]];
             tempa[3] = sbox[u8tmp];
+        } else if (Nk > 6 && i % Nk == 4) {
+            // AES-256 applies SubWord halfway through each key-length block
+            tempa[0] = sbox[tempa[0]];
+            tempa[1] = sbox[tempa[1]];
+            tempa[2] = sbox[tempa[2]];
+            tempa[3] = sbox[tempa[3]];
         }
 
         j = i * 4;
@@ -111,82 +133,437 @@ static void KeyExpansion(uint8_t* RoundKey, const uint8_t* Key) {
 }
 
 /*
- * AddRoundKey XORs the state with a portion of the expanded key corresponding to the current round.
+ * The portable rounds keep the state as four 32-bit columns. Column c holds
+ * state bytes 4c..4c+3 with row r in bits 8r..8r+7, so the byte order in
+ * memory maps to a little-endian load on any host.
+ */
+#define LOAD_COLUMN(p)  ((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | \
+                         ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+#define STORE_COLUMN(p, v) { (p)[0] = (uint8_t)(v); (p)[1] = (uint8_t)((v) >> 8); \
+                             (p)[2] = (uint8_t)((v) >> 16); (p)[3] = (uint8_t)((v) >> 24); }
+
+// Rotating a column right by 8 bits moves row r+1 into row r
+#define ROTR8(w)  (((w) >> 8) | ((w) << 24))
+#define ROTR16(w) (((w) >> 16) | ((w) << 16))
+
+/*
+ * AddRoundKey XORs the four state columns with the round key of the given round.
  * This step integrates the key material into the state.
  */
-static void AddRoundKey(uint8_t round, uint8_t* state, const uint8_t* RoundKey) {
-    for (uint8_t i = 0; i < 16; ++i) {
-        state[i] ^= RoundKey[(round * Nb * 4) + i];
+static ALWAYS_INLINE void AddRoundKey(unsigned round, uint32_t* state, const uint8_t* RoundKey) {
+    const uint8_t* rk = RoundKey + round * Nb * 4;
+
+    state[0] ^= LOAD_COLUMN(rk);
+    state[1] ^= LOAD_COLUMN(rk + 4);
+    state[2] ^= LOAD_COLUMN(rk + 8);
+    state[3] ^= LOAD_COLUMN(rk + 12);
+}
+
+/*
+ * SubShiftRows applies SubBytes and ShiftRows in one pass. ShiftRows is folded
+ * into the indexing: row r of output column c comes from input column (c + r) mod 4.
+ */
+static ALWAYS_INLINE void SubShiftRows(uint32_t* state) {
+    uint32_t s0 = state[0], s1 = state[1], s2 = state[2], s3 = state[3];
+
+#define SUB_COLUMN(a, b, c, d) ((uint32_t)sbox[(a) & 0xff] | \
+                                ((uint32_t)sbox[((b) >> 8) & 0xff] << 8) | \
+                                ((uint32_t)sbox[((c) >> 16) & 0xff] << 16) | \
+                                ((uint32_t)sbox[(d) >> 24] << 24))
+    state[0] = SUB_COLUMN(s0, s1, s2, s3);
+    state[1] = SUB_COLUMN(s1, s2, s3, s0);
+    state[2] = SUB_COLUMN(s2, s3, s0, s1);
+    state[3] = SUB_COLUMN(s3, s0, s1, s2);
+#undef SUB_COLUMN
+}
+
+/*
+ * xtime multiplies each of the four bytes packed in a word by 2 in GF(2^8):
+ * shift every byte left and reduce the bytes whose top bit overflowed by 0x1b.
+ */
+static ALWAYS_INLINE uint32_t xtime(uint32_t w) {
+    return ((w & 0x7f7f7f7fU) << 1) ^ (((w >> 7) & 0x01010101U) * 0x1b);
+}
+
+/*
+ * MixColumns mixes the bytes of each column using a fixed polynomial.
+ * With a[r] the bytes of a column, b[r] = 2*a[r] ^ 3*a[r+1] ^ a[r+2] ^ a[r+3],
+ * which is computed for all four rows at once as
+ *     b = 2*(a ^ a<<<1) ^ a<<<1 ^ (a ^ a<<<1)<<<2
+ * where <<<k rotates the column by k rows.
+ */
+static ALWAYS_INLINE void MixColumns(uint32_t* state) {
+    for (int i = 0; i < 4; ++i) {
+        const uint32_t a = state[i];
+        const uint32_t t = a ^ ROTR8(a);
+        state[i] = xtime(t) ^ ROTR8(a) ^ ROTR16(t);
     }
 }
 
 /*
- * SubBytes substitutes each byte in the state with its corresponding byte in the S-box.
- * This non-linear substitution provides confusion in the cipher.
+ * Cipher runs the full AES cipher for Nr rounds. It is always inlined into the
+ * per-key-size functions below with a constant Nr, so every round is unrolled,
+ * the extra rounds of the larger key sizes are resolved at compile time and
+ * every round-key offset is a constant.
  */
-static void SubBytes(uint8_t* state) {
-    for (uint8_t i = 0; i < 16; ++i) {
-        state[i] = sbox[state[i]];
+static ALWAYS_INLINE void Cipher(const unsigned Nr, const uint8_t* RoundKey,
+                                 uint8_t* output, const uint8_t* input) {
+    uint32_t state[4];
+
+    state[0] = LOAD_COLUMN(input);
+    state[1] = LOAD_COLUMN(input + 4);
+    state[2] = LOAD_COLUMN(input + 8);
+    state[3] = LOAD_COLUMN(input + 12);
+
+    AddRoundKey(0, state, RoundKey);
+
+#define ROUND(r) SubShiftRows(state); MixColumns(state); AddRoundKey((r), state, RoundKey);
+    ROUND(1) ROUND(2) ROUND(3) ROUND(4) ROUND(5) ROUND(6) ROUND(7) ROUND(8) ROUND(9)
+    if (Nr > 10) {
+        ROUND(10) ROUND(11)
+    }
+    if (Nr > 12) {
+        ROUND(12) ROUND(13)
     }
+#undef ROUND
+
+    // Final round without MixColumns
+    SubShiftRows(state);
+    AddRoundKey(Nr, state, RoundKey);
+
+    STORE_COLUMN(output,      state[0]);
+    STORE_COLUMN(output + 4,  state[1]);
+    STORE_COLUMN(output + 8,  state[2]);
+    STORE_COLUMN(output + 12, state[3]);
 }
 
 /*
- * ShiftRows shifts the rows of the state cyclically to the left by different offsets.
- * This step provides diffusion by transposing the bytes within each row.
+ * aes128e_block_portable performs AES-128 encryption on a single 16-byte block
+ * using the round keys held in ctx.
  */
-static void ShiftRows(uint8_t* state) {
-    uint8_t temp;
+void aes128e_block_portable(const aes128_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    Cipher(AES128_NR, ctx->RoundKey, output, input);
+}
+
+// AES-192 and AES-256 counterparts, unrolled for 12 and 14 rounds
+static void aes192e_block_portable(const uint8_t* RoundKey, uint8_t* output, const uint8_t* input) {
+    Cipher(AES192_NR, RoundKey, output, input);
+}
 
-    // Row 1 (1-byte left circular shift)
-    temp = state[1];
-    state[1]  = state[5];
-    state[5]  = state[9];
-    state[9]  = state[13];
-    state[13] = temp;
+static void aes256e_block_portable(const uint8_t* RoundKey, uint8_t* output, const uint8_t* input) {
+    Cipher(AES256_NR, RoundKey, output, input);
+}
+
+/*
+ * Engine registry. Each entry is the complete function-pointer table of one
+ * engine; selecting an engine publishes a pointer to its entry in active with
+ * one atomic store, so every call below is a single load and indirect call
+ * with no per-block branching, and a call made while another thread switches
+ * engines runs wholly on the old table or wholly on the new one. AES-192 and
+ * AES-256 have the unrolled portable rounds and an AES-NI version; the
+ * constant-time engines use the portable rounds for them, so their
+ * guarantee is for AES-128 only.
+ * Decryption (aes128d.c) is part of the entry, so it always matches the
+ * encryption engine: the constant-time engines decrypt with the bitsliced
+ * inverse cipher, never with the Td tables.
+ */
+typedef struct {
+    aes128_backend backend;
+    const char* name;
+    int (*supported)(void);
+    void (*expand_key)(aes128_ctx*, const uint8_t*);
+    void (*expand_keys)(aes128_ctx*, const uint8_t*, size_t);
+    void (*encrypt_block)(const aes128_ctx*, uint8_t*, const uint8_t*);
+    void (*encrypt_blocks)(const aes128_ctx*, uint8_t*, const uint8_t*, size_t);
+    void (*encrypt_multikey)(const aes128_ctx* const*, uint8_t*, const uint8_t*, size_t);
+    void (*encrypt_block_192)(const uint8_t*, uint8_t*, const uint8_t*);
+    void (*encrypt_block_256)(const uint8_t*, uint8_t*, const uint8_t*);
+    void (*decrypt_block)(const aes128d_ctx*, uint8_t*, const uint8_t*);
+    void (*decrypt_blocks)(const aes128d_ctx*, uint8_t*, const uint8_t*, size_t);
+} aes_engine;
 
-    // Row 2 (2-byte left circular shift)
-    temp = state[2];
-    state[2]  = state[10];
-    state[10] = temp;
-    temp = state[6];
-    state[6]  = state[14];
-    state[14] = temp;
+static _Atomic(const aes_engine*) active;
 
-    // Row 3 (3-byte left circular shift, equivalent to 1-byte right circular shift)
-    temp = state[3];
-    state[3]  = state[15];
-    state[15] = state[11];
-    state[11] = state[7];
-    state[7]  = temp;
+// The engine in use; its table never changes once published
+static inline const aes_engine* engine(void) {
+    return atomic_load_explicit(&active, memory_order_acquire);
 }
 
+static int always_supported(void) {
+    return 1;
+}
+
+static void expand_key_portable(aes128_ctx* ctx, const uint8_t* key) {
+    KeyExpansion(ctx->RoundKey, key, AES128_NK, AES128_NR);
+}
+
+/*
+ * Batched paths for engines that only have the single-block (or single-key)
+ * primitive. Each loop calls its own engine's primitive rather than the
+ * active one, so an engine can be self-tested before it is published.
+ */
+static void expand_keys_portable(aes128_ctx* ctxs, const uint8_t* keys, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        expand_key_portable(&ctxs[i], keys + 16 * i);
+    }
+}
+
+static void encrypt_blocks_portable(const aes128_ctx* ctx, uint8_t* output,
+                                    const uint8_t* input, size_t nblocks) {
+    for (size_t i = 0; i < nblocks; ++i) {
+        aes128e_block_portable(ctx, output + 16 * i, input + 16 * i);
+    }
+}
+
+static void encrypt_blocks_vpaes(const aes128_ctx* ctx, uint8_t* output,
+                                 const uint8_t* input, size_t nblocks) {
+    for (size_t i = 0; i < nblocks; ++i) {
+        aes128e_block_vpaes(ctx, output + 16 * i, input + 16 * i);
+    }
+}
+
+static void encrypt_multikey_portable(const aes128_ctx* const* ctxs, uint8_t* output,
+                                      const uint8_t* input, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        aes128e_block_portable(ctxs[i], output + 16 * i, input + 16 * i);
+    }
+}
+
+static void encrypt_multikey_ttable(const aes128_ctx* const* ctxs, uint8_t* output,
+                                    const uint8_t* input, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        aes128e_block_ttable(ctxs[i], output + 16 * i, input + 16 * i);
+    }
+}
+
+static void encrypt_multikey_vpaes(const aes128_ctx* const* ctxs, uint8_t* output,
+                                   const uint8_t* input, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        aes128e_block_vpaes(ctxs[i], output + 16 * i, input + 16 * i);
+    }
+}
+
+static const aes_engine engines[] = {
+    { AES128_BACKEND_PORTABLE, "portable", always_supported,
+      expand_key_portable, expand_keys_portable, aes128e_block_portable,
+      encrypt_blocks_portable, encrypt_multikey_portable,
+      aes192e_block_portable, aes256e_block_portable,
+      aes128d_block_table, aes128d_blocks_table },
+    { AES128_BACKEND_TTABLE, "ttable", always_supported,
+      expand_key_portable, expand_keys_portable, aes128e_block_ttable,
+      aes128e_blocks_ttable, encrypt_multikey_ttable,
+      aes192e_block_portable, aes256e_block_portable,
+      aes128d_block_table, aes128d_blocks_table },
+    { AES128_BACKEND_AESNI, "aesni", aes128_aesni_supported,
+      aes128_expand_key_aesni, aes128_expand_keys_aesni, aes128e_block_aesni,
+      aes128e_blocks_aesni, aes128e_multikey_aesni,
+      aes192e_block_aesni, aes256e_block_aesni,
+      aes128d_block_aesni, aes128d_blocks_aesni },
+    { AES128_BACKEND_BITSLICE, "bitslice", aes128_bitslice_supported,
+      aes128_expand_key_bitslice, aes128_expand_keys_bitslice, aes128e_block_bitslice,
+      aes128e_blocks_bitslice, aes128e_multikey_bitslice,
+      aes192e_block_portable, aes256e_block_portable,
+      aes128d_block_bitslice, aes128d_blocks_bitslice },
+    // Both need only SSSE3, so vpaes can borrow the bitsliced inverse cipher
+    { AES128_BACKEND_VPAES, "vpaes", aes128_vpaes_supported,
+      aes128_expand_key_vpaes, aes128_expand_keys_vpaes, aes128e_block_vpaes,
+      encrypt_blocks_vpaes, encrypt_multikey_vpaes,
+      aes192e_block_portable, aes256e_block_portable,
+      aes128d_block_bitslice, aes128d_blocks_bitslice },
+};
+
 /*
- * xtime multiplies a byte by 2 in the GF(2^8) finite field.
- * This operation is used in the MixColumns step to perform polynomial multiplication.
+ * Automatic choice, fastest first for the chained single-block path that OFB
+ * depends on. The bitsliced engine only pays off for long batches, so it is
+ * never picked automatically.
  */
-static void xtime(uint8_t* x) {
-    *x = (*x << 1) ^ ((*x & 0x80) ? 0x1b : 0x00);
+static const aes128_backend auto_order[] = {
+    AES128_BACKEND_AESNI, AES128_BACKEND_VPAES, AES128_BACKEND_TTABLE, AES128_BACKEND_PORTABLE
+};
+
+static const aes_engine* find_engine(aes128_backend backend) {
+    for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); ++i) {
+        if (engines[i].backend == backend) {
+            return &engines[i];
+        }
+    }
+    return NULL;
 }
 
 /*
- * MixColumns mixes the bytes of each column in the state using a fixed polynomial.
- * This step provides diffusion by combining the bytes within each column.
+ * self_test runs the FIPS-197 Appendix C known answers through every entry
+ * point of engine e, before it is published: single and batched key expansion, single,
+ * multi-block and multi-key encryption, single and multi-block decryption,
+ * and the AES-192/AES-256 rounds.
+ * Nine blocks cover both a full group and a tail in every interleaved path.
  */
-static void MixColumns(uint8_t* state) {
-    uint8_t Tmp, Tm, t;
-    for (int i = 0; i < 4; ++i) {
-        t = state[i*4+0];
-        Tmp = state[i*4+0] ^ state[i*4+1] ^ state[i*4+2] ^ state[i*4+3];
-        
-        // Perform multiplication and XOR operations in GF(2^8)
-        Tm = state[i*4+0] ^ state[i*4+1]; xtime(&Tm); state[i*4+0] ^= Tm ^ Tmp;
+static int self_test(const aes_engine* e) {
+    static const uint8_t key[32] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+    };
+    static const uint8_t plaintext[16] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+    };
+    static const uint8_t expected[3][16] = {
+        { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a },
+        { 0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91 },
+        { 0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89 }
+    };
+    aes128_ctx ctx, ctxs[9];
+    aes128d_ctx dctx;
+    const aes128_ctx* lanes[9];
+    uint8_t keys[9 * 16], blocks[9 * 16], round_keys[240];
+
+    e->expand_key(&ctx, key);
+    e->encrypt_block(&ctx, blocks, plaintext);
+    if (memcmp(blocks, expected[0], 16) != 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < 9; ++i) {
+        memcpy(keys + 16 * i, key, 16);
+        memcpy(blocks + 16 * i, plaintext, 16);
+        lanes[i] = &ctxs[i];
+    }
+
+    e->expand_keys(ctxs, keys, 9);
+    e->encrypt_multikey(lanes, blocks, blocks, 9);
+    for (int i = 0; i < 9; ++i) {
+        if (memcmp(blocks + 16 * i, expected[0], 16) != 0) {
+            return 0;
+        }
+        memcpy(blocks + 16 * i, plaintext, 16);
+    }
 
-        Tm = state[i*4+1] ^ state[i*4+2]; xtime(&Tm); state[i*4+1] ^= Tm ^ Tmp;
+    e->encrypt_blocks(&ctx, blocks, blocks, 9);
+    for (int i = 0; i < 9; ++i) {
+        if (memcmp(blocks + 16 * i, expected[0], 16) != 0) {
+            return 0;
+        }
+    }
 
-        Tm = state[i*4+2] ^ state[i*4+3]; xtime(&Tm); state[i*4+2] ^= Tm ^ Tmp;
+    aes128d_init_from(&dctx, &ctx);
+    e->decrypt_blocks(&dctx, blocks, blocks, 9);
+    for (int i = 0; i < 9; ++i) {
+        if (memcmp(blocks + 16 * i, plaintext, 16) != 0) {
+            return 0;
+        }
+    }
+    e->decrypt_block(&dctx, blocks, expected[0]);
+    if (memcmp(blocks, plaintext, 16) != 0) {
+        return 0;
+    }
 
-        Tm = state[i*4+3] ^ t;            xtime(&Tm); state[i*4+3] ^= Tm ^ Tmp;
+    KeyExpansion(round_keys, key, AES192_NK, AES192_NR);
+    e->encrypt_block_192(round_keys, blocks, plaintext);
+    if (memcmp(blocks, expected[1], 16) != 0) {
+        return 0;
     }
+    KeyExpansion(round_keys, key, AES256_NK, AES256_NR);
+    e->encrypt_block_256(round_keys, blocks, plaintext);
+    return memcmp(blocks, expected[2], 16) == 0;
+}
+
+/*
+ * select_engine makes e the active engine if the CPU supports it and it
+ * passes the self-test; otherwise the previous engine stays in place. Other
+ * threads only ever see a tested engine.
+ */
+static int select_engine(const aes_engine* e) {
+    if (!e || !e->supported() || !self_test(e)) {
+        return -1;
+    }
+    atomic_store_explicit(&active, e, memory_order_release);
+    return 0;
+}
+
+int aes128_set_backend(aes128_backend backend) {
+    if (backend != AES128_BACKEND_AUTO) {
+        return select_engine(find_engine(backend));
+    }
+
+    const char* requested = getenv("AES_BACKEND");
+    if (requested && *requested && strcmp(requested, "auto") != 0) {
+        for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); ++i) {
+            if (strcmp(requested, engines[i].name) == 0 && select_engine(&engines[i]) == 0) {
+                return 0;
+            }
+        }
+        fprintf(stderr, "AES_BACKEND=%s is unknown, unsupported or failed its self-test; "
+                        "choosing automatically\n", requested);
+    }
+
+    for (size_t i = 0; i < sizeof(auto_order) / sizeof(auto_order[0]); ++i) {
+        if (select_engine(find_engine(auto_order[i])) == 0) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*
+ * The engine is resolved once, when the program starts, so that no entry
+ * point has to check for it. A build where no engine passes its self-test
+ * must not produce ciphertext at all.
+ */
+__attribute__((constructor)) static void resolve_backend(void) {
+    if (aes128_set_backend(AES128_BACKEND_AUTO) != 0) {
+        fprintf(stderr, "AES self-test failed for every engine\n");
+        abort();
+    }
+}
+
+aes128_backend aes128_get_backend(void) {
+    return engine()->backend;
+}
+
+const char* aes128_backend_name(aes128_backend backend) {
+    const aes_engine* e = find_engine(backend);
+
+    return e ? e->name : "auto";
+}
+
+/*
+ * aes128_init expands the cipher key once so that it can be reused for
+ * every block encrypted under that key.
+ */
+void aes128_init(aes128_ctx* ctx, const uint8_t* key) {
+    engine()->expand_key(ctx, key);
+}
+
+/*
+ * aes128_init_batch expands n keys at once. The AES-NI engine interleaves four
+ * key schedules, the vector-permute and bitsliced engines share each SubWord
+ * step between 4 and 32 keys; the table engines expand one key at a time.
+ */
+void aes128_init_batch(aes128_ctx* ctxs, const uint8_t* keys, size_t n) {
+    engine()->expand_keys(ctxs, keys, n);
+}
+
+/*
+ * aes128e_block performs AES-128 encryption on a single 16-byte block
+ * using the round keys held in ctx and the selected engine.
+ */
+void aes128e_block(const aes128_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    engine()->encrypt_block(ctx, output, input);
+}
+
+/*
+ * aes128e_blocks encrypts nblocks independent 16-byte blocks (ECB) with the
+ * selected engine. The AES-NI, T-table and bitsliced engines interleave the
+ * rounds of 8, 4 and 8 blocks respectively; the others loop over blocks.
+ */
+void aes128e_blocks(const aes128_ctx* ctx, uint8_t* output, const uint8_t* input, size_t nblocks) {
+    engine()->encrypt_blocks(ctx, output, input, nblocks);
+}
+
+/*
+ * aes128e_multikey encrypts block i of input under ctxs[i]. The AES-NI and
+ * bitsliced engines run eight keys through the rounds together.
+ */
+void aes128e_multikey(const aes128_ctx* const* ctxs, uint8_t* output, const uint8_t* input, size_t n) {
+    engine()->encrypt_multikey(ctxs, output, input, n);
 }
 
 /*
@@ -194,25 +571,55 @@ static void MixColumns(uint8_t* state) {
  * It takes an input block and a 128-bit key and produces the encrypted output block.
  */
 void aes128e(uint8_t* output, const uint8_t* input, const uint8_t* key) {
-    uint8_t RoundKey[176]; // Expanded key for all rounds
-    uint8_t state[16];
-    memcpy(state, input, 16);
+    aes128_ctx ctx;
 
-    KeyExpansion(RoundKey, key);
+    aes128_init(&ctx, key);
+    aes128e_block(&ctx, output, input);
+}
 
-    AddRoundKey(0, state, RoundKey);
+/*
+ * aes128d_block and aes128d_blocks decrypt with the selected engine's
+ * inverse cipher; the schedule itself is built in aes128d.c. The AES-NI,
+ * bitsliced and T-table inverses interleave 8, 8 and 4 blocks.
+ */
+void aes128d_block(const aes128d_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    engine()->decrypt_block(ctx, output, input);
+}
 
-    for (uint8_t round = 1; round < Nr; ++round) {
-        SubBytes(state);
-        ShiftRows(state);
-        MixColumns(state);
-        AddRoundKey(round, state, RoundKey);
-    }
+void aes128d_blocks(const aes128d_ctx* ctx, uint8_t* output, const uint8_t* input, size_t nblocks) {
+    engine()->decrypt_blocks(ctx, output, input, nblocks);
+}
 
-    // Final round without MixColumns
-    SubBytes(state);
-    ShiftRows(state);
-    AddRoundKey(Nr, state, RoundKey);
+/*
+ * AES-192 and AES-256 entry points. They share the round functions above and
+ * the engine selection (see the encrypt_block_192/encrypt_block_256 entries).
+ */
+void aes192_init(aes192_ctx* ctx, const uint8_t* key) {
+    KeyExpansion(ctx->RoundKey, key, AES192_NK, AES192_NR);
+}
+
+void aes192e_block(const aes192_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    engine()->encrypt_block_192(ctx->RoundKey, output, input);
+}
+
+void aes192e(uint8_t* output, const uint8_t* input, const uint8_t* key) {
+    aes192_ctx ctx;
+
+    aes192_init(&ctx, key);
+    aes192e_block(&ctx, output, input);
+}
+
+void aes256_init(aes256_ctx* ctx, const uint8_t* key) {
+    KeyExpansion(ctx->RoundKey, key, AES256_NK, AES256_NR);
+}
+
+void aes256e_block(const aes256_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    engine()->encrypt_block_256(ctx->RoundKey, output, input);
+}
+
+void aes256e(uint8_t* output, const uint8_t* input, const uint8_t* key) {
+    aes256_ctx ctx;
 
-    memcpy(output, state, 16);
+    aes256_init(&ctx, key);
+    aes256e_block(&ctx, output, input);
 }
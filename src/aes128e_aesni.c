@@ -0,0 +1,355 @@
+/********************************************************************************
+ * aes128e_aesni.c
+ *
+ * This file implements AES-128 key expansion and block encryption with the
+ * x86 AES-NI instructions (AESENC, AESENCLAST and AESKEYGENASSIST). Each
+ * round is a single instruction operating on the whole 128-bit state.
+ *
+ * The key schedule is stored in the same FIPS-197 byte order as the portable
+ * KeyExpansion, so contexts expanded here can be used by every other engine
+ * and vice versa. The functions are compiled with a per-function target
+ * attribute, so the rest of the project does not need -maes; callers must
+ * check aes128_aesni_supported() before using them.
+ ********************************************************************************/
+
+#include <stdint.h>
+#include "aes128e_impl.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <cpuid.h>
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+#define AESNI_BATCH_TARGET __attribute__((target("aes,sse2,ssse3")))
+
+/*
+ * aes128_aesni_supported reports whether the CPU implements AES-NI
+ * (CPUID leaf 1, ECX bit 25). SSSE3, used by the batched key expansion, is
+ * present on every AES-NI processor but is checked as well.
+ */
+int aes128_aesni_supported(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (ecx & bit_AES) != 0 && (ecx & bit_SSSE3) != 0;
+}
+
+/*
+ * expand_step derives the next round key from the previous one and the
+ * AESKEYGENASSIST result (RotWord(SubWord(w3)) ^ Rcon in the top word).
+ */
+static AESNI_TARGET __m128i expand_step(__m128i key, __m128i assist) {
+    assist = _mm_shuffle_epi32(assist, 0xff);
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+// AESKEYGENASSIST takes the round constant as an immediate operand
+#define EXPAND(k, rcon) expand_step((k), _mm_aeskeygenassist_si128((k), (rcon)))
+
+/*
+ * aes128_expand_key_aesni generates the 11 round keys of the AES-128 key schedule.
+ */
+AESNI_TARGET void aes128_expand_key_aesni(aes128_ctx* ctx, const uint8_t* key) {
+    __m128i* rk = (__m128i*) ctx->RoundKey;
+    __m128i k = _mm_loadu_si128((const __m128i*) key);
+
+    _mm_storeu_si128(rk + 0, k);
+    k = EXPAND(k, 0x01); _mm_storeu_si128(rk + 1, k);
+    k = EXPAND(k, 0x02); _mm_storeu_si128(rk + 2, k);
+    k = EXPAND(k, 0x04); _mm_storeu_si128(rk + 3, k);
+    k = EXPAND(k, 0x08); _mm_storeu_si128(rk + 4, k);
+    k = EXPAND(k, 0x10); _mm_storeu_si128(rk + 5, k);
+    k = EXPAND(k, 0x20); _mm_storeu_si128(rk + 6, k);
+    k = EXPAND(k, 0x40); _mm_storeu_si128(rk + 7, k);
+    k = EXPAND(k, 0x80); _mm_storeu_si128(rk + 8, k);
+    k = EXPAND(k, 0x1B); _mm_storeu_si128(rk + 9, k);
+    k = EXPAND(k, 0x36); _mm_storeu_si128(rk + 10, k);
+}
+
+/*
+ * expand_step_enclast is expand_step with RotWord(SubWord(w3)) ^ Rcon computed
+ * by AESENCLAST instead of AESKEYGENASSIST: PSHUFB broadcasts the rotated w3
+ * into all four columns, so ShiftRows is a no-op and the last round reduces
+ * to SubBytes plus the round constant. AESKEYGENASSIST is microcoded on most
+ * cores, while AESENCLAST issues every cycle, so independent schedules
+ * expanded this way actually overlap.
+ */
+static AESNI_BATCH_TARGET __m128i expand_step_enclast(__m128i key, __m128i rcon) {
+    const __m128i rot_w3 = _mm_set1_epi32(0x0c0f0e0d);
+    __m128i assist = _mm_aesenclast_si128(_mm_shuffle_epi8(key, rot_w3), rcon);
+
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+/*
+ * aes128_expand_keys_aesni expands n keys (16 * n bytes at keys), four at a
+ * time. The four key schedules are independent chains, so interleaving them
+ * hides the AESENCLAST latency that bounds a single key expansion.
+ */
+AESNI_BATCH_TARGET void aes128_expand_keys_aesni(aes128_ctx* ctxs, const uint8_t* keys, size_t n) {
+    static const uint8_t Rcon[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36 };
+    const __m128i* in = (const __m128i*) keys;
+
+    for (; n >= 4; n -= 4, ctxs += 4, in += 4) {
+        __m128i* rk0 = (__m128i*) ctxs[0].RoundKey;
+        __m128i* rk1 = (__m128i*) ctxs[1].RoundKey;
+        __m128i* rk2 = (__m128i*) ctxs[2].RoundKey;
+        __m128i* rk3 = (__m128i*) ctxs[3].RoundKey;
+        __m128i k0 = _mm_loadu_si128(in + 0);
+        __m128i k1 = _mm_loadu_si128(in + 1);
+        __m128i k2 = _mm_loadu_si128(in + 2);
+        __m128i k3 = _mm_loadu_si128(in + 3);
+
+        _mm_store_si128(rk0, k0);
+        _mm_store_si128(rk1, k1);
+        _mm_store_si128(rk2, k2);
+        _mm_store_si128(rk3, k3);
+        for (int r = 1; r <= 10; ++r) {
+            const __m128i rcon = _mm_set1_epi32(Rcon[r - 1]);
+
+            k0 = expand_step_enclast(k0, rcon); _mm_store_si128(rk0 + r, k0);
+            k1 = expand_step_enclast(k1, rcon); _mm_store_si128(rk1 + r, k1);
+            k2 = expand_step_enclast(k2, rcon); _mm_store_si128(rk2 + r, k2);
+            k3 = expand_step_enclast(k3, rcon); _mm_store_si128(rk3 + r, k3);
+        }
+    }
+
+    for (; n > 0; --n, ++ctxs, ++in) {
+        aes128_expand_key_aesni(ctxs, (const uint8_t*) in);
+    }
+}
+
+/*
+ * aes128e_block_aesni performs AES-128 encryption on a single 16-byte block:
+ * an initial AddRoundKey, nine AESENC rounds and a final AESENCLAST.
+ */
+AESNI_TARGET void aes128e_block_aesni(const aes128_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    const __m128i* rk = (const __m128i*) ctx->RoundKey;
+    __m128i state = _mm_loadu_si128((const __m128i*) input);
+
+    state = _mm_xor_si128(state, _mm_loadu_si128(rk));
+    for (int round = 1; round < 10; ++round) {
+        state = _mm_aesenc_si128(state, _mm_loadu_si128(rk + round));
+    }
+    state = _mm_aesenclast_si128(state, _mm_loadu_si128(rk + 10));
+
+    _mm_storeu_si128((__m128i*) output, state);
+}
+
+/*
+ * aes128e_blocks_aesni encrypts nblocks independent blocks, eight at a time.
+ * AESENC has a latency of several cycles but can start a new round every
+ * cycle, so issuing the same round for eight blocks back to back keeps the
+ * AES unit busy instead of stalling on one block's dependency chain.
+ */
+AESNI_TARGET void aes128e_blocks_aesni(const aes128_ctx* ctx, uint8_t* output,
+                                       const uint8_t* input, size_t nblocks) {
+    const __m128i* in = (const __m128i*) input;
+    __m128i* out = (__m128i*) output;
+    __m128i rk[11];
+    __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+    for (int i = 0; i < 11; ++i) {
+        rk[i] = _mm_loadu_si128((const __m128i*) ctx->RoundKey + i);
+    }
+
+    for (; nblocks >= 8; nblocks -= 8, in += 8, out += 8) {
+        b0 = _mm_xor_si128(_mm_loadu_si128(in + 0), rk[0]);
+        b1 = _mm_xor_si128(_mm_loadu_si128(in + 1), rk[0]);
+        b2 = _mm_xor_si128(_mm_loadu_si128(in + 2), rk[0]);
+        b3 = _mm_xor_si128(_mm_loadu_si128(in + 3), rk[0]);
+        b4 = _mm_xor_si128(_mm_loadu_si128(in + 4), rk[0]);
+        b5 = _mm_xor_si128(_mm_loadu_si128(in + 5), rk[0]);
+        b6 = _mm_xor_si128(_mm_loadu_si128(in + 6), rk[0]);
+        b7 = _mm_xor_si128(_mm_loadu_si128(in + 7), rk[0]);
+
+        for (int round = 1; round < 10; ++round) {
+            b0 = _mm_aesenc_si128(b0, rk[round]);
+            b1 = _mm_aesenc_si128(b1, rk[round]);
+            b2 = _mm_aesenc_si128(b2, rk[round]);
+            b3 = _mm_aesenc_si128(b3, rk[round]);
+            b4 = _mm_aesenc_si128(b4, rk[round]);
+            b5 = _mm_aesenc_si128(b5, rk[round]);
+            b6 = _mm_aesenc_si128(b6, rk[round]);
+            b7 = _mm_aesenc_si128(b7, rk[round]);
+        }
+
+        _mm_storeu_si128(out + 0, _mm_aesenclast_si128(b0, rk[10]));
+        _mm_storeu_si128(out + 1, _mm_aesenclast_si128(b1, rk[10]));
+        _mm_storeu_si128(out + 2, _mm_aesenclast_si128(b2, rk[10]));
+        _mm_storeu_si128(out + 3, _mm_aesenclast_si128(b3, rk[10]));
+        _mm_storeu_si128(out + 4, _mm_aesenclast_si128(b4, rk[10]));
+        _mm_storeu_si128(out + 5, _mm_aesenclast_si128(b5, rk[10]));
+        _mm_storeu_si128(out + 6, _mm_aesenclast_si128(b6, rk[10]));
+        _mm_storeu_si128(out + 7, _mm_aesenclast_si128(b7, rk[10]));
+    }
+
+    for (; nblocks > 0; --nblocks, ++in, ++out) {
+        b0 = _mm_xor_si128(_mm_loadu_si128(in), rk[0]);
+        for (int round = 1; round < 10; ++round) {
+            b0 = _mm_aesenc_si128(b0, rk[round]);
+        }
+        _mm_storeu_si128(out, _mm_aesenclast_si128(b0, rk[10]));
+    }
+}
+
+/*
+ * aes128e_multikey_aesni encrypts block i under ctxs[i], eight blocks per
+ * pass. Each lane loads its own round key, but the AESENC instructions of the
+ * eight lanes are still issued back to back, so throughput with many keys
+ * matches the single-key aes128e_blocks_aesni.
+ */
+AESNI_TARGET void aes128e_multikey_aesni(const aes128_ctx* const* ctxs, uint8_t* output,
+                                         const uint8_t* input, size_t n) {
+    const __m128i* in = (const __m128i*) input;
+    __m128i* out = (__m128i*) output;
+    const __m128i *k0, *k1, *k2, *k3, *k4, *k5, *k6, *k7;
+    __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+    for (; n >= 8; n -= 8, ctxs += 8, in += 8, out += 8) {
+        k0 = (const __m128i*) ctxs[0]->RoundKey;
+        k1 = (const __m128i*) ctxs[1]->RoundKey;
+        k2 = (const __m128i*) ctxs[2]->RoundKey;
+        k3 = (const __m128i*) ctxs[3]->RoundKey;
+        k4 = (const __m128i*) ctxs[4]->RoundKey;
+        k5 = (const __m128i*) ctxs[5]->RoundKey;
+        k6 = (const __m128i*) ctxs[6]->RoundKey;
+        k7 = (const __m128i*) ctxs[7]->RoundKey;
+
+        b0 = _mm_xor_si128(_mm_loadu_si128(in + 0), _mm_loadu_si128(k0));
+        b1 = _mm_xor_si128(_mm_loadu_si128(in + 1), _mm_loadu_si128(k1));
+        b2 = _mm_xor_si128(_mm_loadu_si128(in + 2), _mm_loadu_si128(k2));
+        b3 = _mm_xor_si128(_mm_loadu_si128(in + 3), _mm_loadu_si128(k3));
+        b4 = _mm_xor_si128(_mm_loadu_si128(in + 4), _mm_loadu_si128(k4));
+        b5 = _mm_xor_si128(_mm_loadu_si128(in + 5), _mm_loadu_si128(k5));
+        b6 = _mm_xor_si128(_mm_loadu_si128(in + 6), _mm_loadu_si128(k6));
+        b7 = _mm_xor_si128(_mm_loadu_si128(in + 7), _mm_loadu_si128(k7));
+
+        for (int round = 1; round < 10; ++round) {
+            b0 = _mm_aesenc_si128(b0, _mm_loadu_si128(k0 + round));
+            b1 = _mm_aesenc_si128(b1, _mm_loadu_si128(k1 + round));
+            b2 = _mm_aesenc_si128(b2, _mm_loadu_si128(k2 + round));
+            b3 = _mm_aesenc_si128(b3, _mm_loadu_si128(k3 + round));
+            b4 = _mm_aesenc_si128(b4, _mm_loadu_si128(k4 + round));
+            b5 = _mm_aesenc_si128(b5, _mm_loadu_si128(k5 + round));
+            b6 = _mm_aesenc_si128(b6, _mm_loadu_si128(k6 + round));
+            b7 = _mm_aesenc_si128(b7, _mm_loadu_si128(k7 + round));
+        }
+
+        _mm_storeu_si128(out + 0, _mm_aesenclast_si128(b0, _mm_loadu_si128(k0 + 10)));
+        _mm_storeu_si128(out + 1, _mm_aesenclast_si128(b1, _mm_loadu_si128(k1 + 10)));
+        _mm_storeu_si128(out + 2, _mm_aesenclast_si128(b2, _mm_loadu_si128(k2 + 10)));
+        _mm_storeu_si128(out + 3, _mm_aesenclast_si128(b3, _mm_loadu_si128(k3 + 10)));
+        _mm_storeu_si128(out + 4, _mm_aesenclast_si128(b4, _mm_loadu_si128(k4 + 10)));
+        _mm_storeu_si128(out + 5, _mm_aesenclast_si128(b5, _mm_loadu_si128(k5 + 10)));
+        _mm_storeu_si128(out + 6, _mm_aesenclast_si128(b6, _mm_loadu_si128(k6 + 10)));
+        _mm_storeu_si128(out + 7, _mm_aesenclast_si128(b7, _mm_loadu_si128(k7 + 10)));
+    }
+
+    if (n == 1) {
+        aes128e_block_aesni(*ctxs, (uint8_t*) out, (const uint8_t*) in);
+    } else if (n == 2) {
+        // Two interleaved chains (authenticated OFB) take this shape on
+        // every block, so they get two lanes of their own: padding to eight
+        // would put six redundant AESENCs behind each round's latency
+        k0 = (const __m128i*) ctxs[0]->RoundKey;
+        k1 = (const __m128i*) ctxs[1]->RoundKey;
+        b0 = _mm_xor_si128(_mm_loadu_si128(in + 0), _mm_loadu_si128(k0));
+        b1 = _mm_xor_si128(_mm_loadu_si128(in + 1), _mm_loadu_si128(k1));
+        for (int round = 1; round < 10; ++round) {
+            b0 = _mm_aesenc_si128(b0, _mm_loadu_si128(k0 + round));
+            b1 = _mm_aesenc_si128(b1, _mm_loadu_si128(k1 + round));
+        }
+        _mm_storeu_si128(out + 0, _mm_aesenclast_si128(b0, _mm_loadu_si128(k0 + 10)));
+        _mm_storeu_si128(out + 1, _mm_aesenclast_si128(b1, _mm_loadu_si128(k1 + 10)));
+    } else if (n > 2) {
+        // Pad a short group to eight lanes: a few blocks are latency bound,
+        // so the spare lanes cost almost nothing compared to running serially
+        const aes128_ctx* lane_ctxs[8];
+        __m128i lanes[8];
+
+        for (size_t i = 0; i < 8; ++i) {
+            lane_ctxs[i] = ctxs[i < n ? i : n - 1];
+            lanes[i] = _mm_loadu_si128(in + (i < n ? i : n - 1));
+        }
+        aes128e_multikey_aesni(lane_ctxs, (uint8_t*) lanes, (const uint8_t*) lanes, 8);
+        for (size_t i = 0; i < n; ++i) {
+            _mm_storeu_si128(out + i, lanes[i]);
+        }
+    }
+}
+
+/*
+ * aes_block_aesni_rounds encrypts one block with an Nr-round FIPS-197 key
+ * schedule. Nr is a constant at every call site below, so the loop bound is
+ * known at compile time.
+ */
+static inline __attribute__((always_inline)) AESNI_TARGET void
+aes_block_aesni_rounds(const unsigned Nr, const uint8_t* RoundKey, uint8_t* output, const uint8_t* input) {
+    const __m128i* rk = (const __m128i*) RoundKey;
+    __m128i state = _mm_xor_si128(_mm_loadu_si128((const __m128i*) input), _mm_loadu_si128(rk));
+
+    for (unsigned round = 1; round < Nr; ++round) {
+        state = _mm_aesenc_si128(state, _mm_loadu_si128(rk + round));
+    }
+    state = _mm_aesenclast_si128(state, _mm_loadu_si128(rk + Nr));
+
+    _mm_storeu_si128((__m128i*) output, state);
+}
+
+AESNI_TARGET void aes192e_block_aesni(const uint8_t* RoundKey, uint8_t* output, const uint8_t* input) {
+    aes_block_aesni_rounds(12, RoundKey, output, input);
+}
+
+AESNI_TARGET void aes256e_block_aesni(const uint8_t* RoundKey, uint8_t* output, const uint8_t* input) {
+    aes_block_aesni_rounds(14, RoundKey, output, input);
+}
+
+#else // !x86
+
+int aes128_aesni_supported(void) {
+    return 0;
+}
+
+// Never selected on this architecture; present so the engine table links.
+void aes128_expand_key_aesni(aes128_ctx* ctx, const uint8_t* key) {
+    (void) ctx; (void) key;
+}
+
+void aes128_expand_keys_aesni(aes128_ctx* ctxs, const uint8_t* keys, size_t n) {
+    (void) ctxs; (void) keys; (void) n;
+}
+
+void aes128e_block_aesni(const aes128_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    (void) ctx; (void) output; (void) input;
+}
+
+void aes128e_blocks_aesni(const aes128_ctx* ctx, uint8_t* output,
+                          const uint8_t* input, size_t nblocks) {
+    (void) ctx; (void) output; (void) input; (void) nblocks;
+}
+
+void aes128e_multikey_aesni(const aes128_ctx* const* ctxs, uint8_t* output,
+                            const uint8_t* input, size_t n) {
+    (void) ctxs; (void) output; (void) input; (void) n;
+}
+
+void aes192e_block_aesni(const uint8_t* RoundKey, uint8_t* output, const uint8_t* input) {
+    (void) RoundKey; (void) output; (void) input;
+}
+
+void aes256e_block_aesni(const uint8_t* RoundKey, uint8_t* output, const uint8_t* input) {
+    (void) RoundKey; (void) output; (void) input;
+}
+
+#endif
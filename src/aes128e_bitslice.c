@@ -0,0 +1,618 @@
+/********************************************************************************
+ * aes128e_bitslice.c
+ *
+ * This file implements a constant-time bitsliced AES-128 engine that encrypts
+ * and decrypts eight independent blocks in parallel with SSE2/SSSE3
+ * instructions.
+ *
+ * The 128 state bytes of eight blocks are transposed into eight 128-bit bit
+ * planes: plane k holds bit (7 - k) of every byte, byte p of a plane covers
+ * state byte p of all eight blocks, and bit (7 - b) of that byte belongs to
+ * block b. In this form:
+ *   - SubBytes is the Boyar-Peralta boolean circuit for the S-box
+ *     (113 XOR/AND/NOT gates applied to whole planes),
+ *   - ShiftRows and the MixColumns rotations are byte shuffles (PSHUFB),
+ *   - xtime is a fixed rewiring of the planes.
+ * No memory access and no branch depends on key or data, so the engine does
+ * not leak through cache timing like the sbox[] lookups in aes128e.c.
+ *
+ * Key expansion runs SubWord through the same circuit, for up to 32 keys at
+ * once when keys are expanded in a batch. Single blocks are
+ * supported but cost as much as eight; use aes128e_blocks() for throughput.
+ *
+ * Decryption (aes128d_blocks) takes the inverse S-box from the same circuit
+ * between two linear maps, so it is constant-time too. The vector-permute
+ * engine has no inverse of its own and decrypts with these functions.
+ *
+ * There is deliberately no AVX2 variant (16 blocks in 256-bit planes). The
+ * engine exists for CPUs without AES-NI, and every x86 CPU with AVX2 also
+ * has AES-NI, which is faster and constant-time as well, so a wider path
+ * would only run where AES-NI has been masked off.
+ ********************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "aes128e_impl.h"
+#include "ofb_secret.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <cpuid.h>
+#include <tmmintrin.h>
+
+#define BITSLICE_TARGET __attribute__((target("sse2,ssse3")))
+
+/*
+ * aes128_bitslice_supported reports whether the CPU implements SSSE3
+ * (CPUID leaf 1, ECX bit 9), which provides the PSHUFB byte shuffle.
+ */
+int aes128_bitslice_supported(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (ecx & bit_SSSE3) != 0;
+}
+
+/*
+ * SWAPMOVE exchanges the bits of b selected by (mask << n) with the bits of a
+ * selected by mask. Three layers of it transpose the 8x8 bit matrix formed by
+ * the same byte of eight registers.
+ */
+#define SWAPMOVE(a, b, mask, n) do {                                              \
+        __m128i t_ = _mm_and_si128(_mm_xor_si128(_mm_srli_epi64((b), (n)), (a)), (mask)); \
+        (a) = _mm_xor_si128((a), t_);                                             \
+        (b) = _mm_xor_si128((b), _mm_slli_epi64(t_, (n)));                        \
+    } while (0)
+
+/*
+ * transpose converts eight blocks into bit planes and back (the network is
+ * its own inverse): register b bit j moves to register (7 - j) bit (7 - b).
+ */
+static BITSLICE_TARGET void transpose(__m128i q[8]) {
+    const __m128i m1 = _mm_set1_epi8(0x55);
+    const __m128i m2 = _mm_set1_epi8(0x33);
+    const __m128i m4 = _mm_set1_epi8(0x0f);
+
+    SWAPMOVE(q[0], q[1], m1, 1);
+    SWAPMOVE(q[2], q[3], m1, 1);
+    SWAPMOVE(q[4], q[5], m1, 1);
+    SWAPMOVE(q[6], q[7], m1, 1);
+
+    SWAPMOVE(q[0], q[2], m2, 2);
+    SWAPMOVE(q[1], q[3], m2, 2);
+    SWAPMOVE(q[4], q[6], m2, 2);
+    SWAPMOVE(q[5], q[7], m2, 2);
+
+    SWAPMOVE(q[0], q[4], m4, 4);
+    SWAPMOVE(q[1], q[5], m4, 4);
+    SWAPMOVE(q[2], q[6], m4, 4);
+    SWAPMOVE(q[3], q[7], m4, 4);
+}
+
+/*
+ * SubBytes on bit planes: the Boyar-Peralta S-box circuit, split into a top
+ * linear layer, a shared non-linear core (GF(2^4) inversion) and a bottom
+ * linear layer that also applies the affine transformation.
+ * q[0] is the most significant bit of every byte.
+ */
+static BITSLICE_TARGET void SubBytes(__m128i q[8]) {
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7;
+    __m128i y1, y2, y3, y4, y5, y6, y7, y8, y9, y10, y11, y12, y13, y14, y15;
+    __m128i y16, y17, y18, y19, y20, y21;
+    __m128i z0, z1, z2, z3, z4, z5, z6, z7, z8, z9, z10, z11, z12, z13, z14, z15, z16, z17;
+    __m128i t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15, t16;
+    __m128i t17, t18, t19, t20, t21, t22, t23, t24, t25, t26, t27, t28, t29, t30, t31;
+    __m128i t32, t33, t34, t35, t36, t37, t38, t39, t40, t41, t42, t43, t44, t45, t46;
+    __m128i t47, t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59, t60, t61;
+    __m128i t62, t63, t64, t65, t66, t67;
+    __m128i s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[0]; x1 = q[1]; x2 = q[2]; x3 = q[3];
+    x4 = q[4]; x5 = q[5]; x6 = q[6]; x7 = q[7];
+
+    // Top linear transformation
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9 = x0 ^ x3;
+    y8 = x0 ^ x5;
+    t0 = x1 ^ x2;
+    y1 = t0 ^ x7;
+    y4 = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2 = y1 ^ x0;
+    y5 = y1 ^ x6;
+    y3 = y5 ^ y8;
+    t1 = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6 = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7 = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    // Non-linear section
+    t2 = y12 & y15;
+    t3 = y3 & y6;
+    t4 = t3 ^ t2;
+    t5 = y4 & x7;
+    t6 = t5 ^ t2;
+    t7 = y13 & y16;
+    t8 = y5 & y1;
+    t9 = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0 = t44 & y15;
+    z1 = t37 & y6;
+    z2 = t33 & x7;
+    z3 = t43 & y16;
+    z4 = t40 & y1;
+    z5 = t29 & y7;
+    z6 = t42 & y11;
+    z7 = t45 & y17;
+    z8 = t41 & y10;
+    z9 = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    // Bottom linear transformation
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0 = t59 ^ t63;
+    s6 = t56 ^ ~t62;
+    s7 = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3 = t53 ^ t66;
+    s4 = t51 ^ t66;
+    s5 = t47 ^ t65;
+    s1 = t64 ^ ~s3;
+    s2 = t55 ^ ~t67;
+
+    q[0] = s0; q[1] = s1; q[2] = s2; q[3] = s3;
+    q[4] = s4; q[5] = s5; q[6] = s6; q[7] = s7;
+}
+
+/*
+ * ShiftRows permutes the bytes of every plane; byte p of the result is
+ * byte SR[p] of the input, which moves the same state byte in all blocks.
+ */
+static BITSLICE_TARGET void ShiftRows(__m128i q[8]) {
+    const __m128i sr = _mm_setr_epi8(0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11);
+
+    for (int k = 0; k < 8; ++k) {
+        q[k] = _mm_shuffle_epi8(q[k], sr);
+    }
+}
+
+/*
+ * xtime multiplies every byte by 2 in GF(2^8). On planes (plane k holds bit
+ * 7 - k) this only rewires them, folding the reduction polynomial 0x1b into
+ * the planes of bits 0, 1, 3 and 4.
+ */
+static BITSLICE_TARGET void xtime(__m128i x[8], const __m128i c[8]) {
+    x[0] = c[1];
+    x[1] = c[2];
+    x[2] = c[3];
+    x[3] = _mm_xor_si128(c[4], c[0]);
+    x[4] = _mm_xor_si128(c[5], c[0]);
+    x[5] = c[6];
+    x[6] = _mm_xor_si128(c[7], c[0]);
+    x[7] = c[0];
+}
+
+/*
+ * MixColumns computes b[r] = 2*(a[r] ^ a[r+1]) ^ a[r+1] ^ (a[r+2] ^ a[r+3])
+ * for every column. The row rotations are byte shuffles within each column
+ * and the multiplication by 2 is xtime above.
+ */
+static BITSLICE_TARGET void MixColumns(__m128i q[8]) {
+    const __m128i rot1 = _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+    const __m128i rot2 = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    __m128i r1[8], c[8], x[8];
+
+    for (int k = 0; k < 8; ++k) {
+        r1[k] = _mm_shuffle_epi8(q[k], rot1);
+        c[k] = _mm_xor_si128(q[k], r1[k]);
+    }
+    xtime(x, c);
+
+    for (int k = 0; k < 8; ++k) {
+        q[k] = _mm_xor_si128(_mm_xor_si128(x[k], r1[k]), _mm_shuffle_epi8(c[k], rot2));
+    }
+}
+
+/*
+ * bitslice_round_key spreads one 16-byte round key over eight planes. Every
+ * block uses the same key, so a plane byte is either 0x00 or 0xFF.
+ */
+static BITSLICE_TARGET void bitslice_round_key(__m128i out[8], const uint8_t* rk) {
+    const __m128i key = _mm_loadu_si128((const __m128i*) rk);
+
+    for (int k = 0; k < 8; ++k) {
+        const __m128i bit = _mm_set1_epi8((char) (0x80 >> k));
+        out[k] = _mm_cmpeq_epi8(_mm_and_si128(key, bit), bit);
+    }
+}
+
+static BITSLICE_TARGET void AddRoundKey(__m128i q[8], const __m128i rk[8]) {
+    for (int k = 0; k < 8; ++k) {
+        q[k] = _mm_xor_si128(q[k], rk[k]);
+    }
+}
+
+/*
+ * encrypt8 runs the ten AES rounds over eight blocks already in plane form.
+ */
+static BITSLICE_TARGET void encrypt8(__m128i q[8], __m128i rk[11][8]) {
+    AddRoundKey(q, rk[0]);
+    for (int round = 1; round < 10; ++round) {
+        SubBytes(q);
+        ShiftRows(q);
+        MixColumns(q);
+        AddRoundKey(q, rk[round]);
+    }
+    SubBytes(q);
+    ShiftRows(q);
+    AddRoundKey(q, rk[10]);
+}
+
+/*
+ * aes128e_blocks_bitslice encrypts nblocks independent 16-byte blocks, eight
+ * at a time. A trailing group of fewer than eight blocks is padded with zero
+ * blocks whose output is discarded.
+ */
+BITSLICE_TARGET void aes128e_blocks_bitslice(const aes128_ctx* ctx, uint8_t* output,
+                                             const uint8_t* input, size_t nblocks) {
+    __m128i rk[11][8];
+    __m128i q[8];
+
+    for (int round = 0; round <= 10; ++round) {
+        bitslice_round_key(rk[round], ctx->RoundKey + 16 * round);
+    }
+
+    while (nblocks > 0) {
+        size_t n = nblocks < 8 ? nblocks : 8;
+
+        for (size_t b = 0; b < 8; ++b) {
+            q[b] = b < n ? _mm_loadu_si128((const __m128i*) (input + 16 * b)) : _mm_setzero_si128();
+        }
+        transpose(q);
+        encrypt8(q, rk);
+        transpose(q);
+        for (size_t b = 0; b < n; ++b) {
+            _mm_storeu_si128((__m128i*) (output + 16 * b), q[b]);
+        }
+
+        input += 16 * n;
+        output += 16 * n;
+        nblocks -= n;
+    }
+}
+
+void aes128e_block_bitslice(const aes128_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    aes128e_blocks_bitslice(ctx, output, input, 1);
+}
+
+/*
+ * aes128e_multikey_bitslice encrypts block i under ctxs[i], eight lanes at a
+ * time. The round keys of the eight lanes go through the same transposition
+ * as the data, so each lane's bits meet its own key; the rounds themselves
+ * are identical to the single-key path. Unused lanes reuse lane 0's key.
+ */
+BITSLICE_TARGET void aes128e_multikey_bitslice(const aes128_ctx* const* ctxs, uint8_t* output,
+                                               const uint8_t* input, size_t n) {
+    __m128i rk[11][8];
+    __m128i q[8];
+
+    while (n > 0) {
+        size_t lanes = n < 8 ? n : 8;
+
+        for (int round = 0; round <= 10; ++round) {
+            for (size_t b = 0; b < 8; ++b) {
+                const aes128_ctx* ctx = ctxs[b < lanes ? b : 0];
+                rk[round][b] = _mm_loadu_si128((const __m128i*) (ctx->RoundKey + 16 * round));
+            }
+            transpose(rk[round]);
+        }
+
+        for (size_t b = 0; b < 8; ++b) {
+            q[b] = b < lanes ? _mm_loadu_si128((const __m128i*) (input + 16 * b)) : _mm_setzero_si128();
+        }
+        transpose(q);
+        encrypt8(q, rk);
+        transpose(q);
+        for (size_t b = 0; b < lanes; ++b) {
+            _mm_storeu_si128((__m128i*) (output + 16 * b), q[b]);
+        }
+
+        ctxs += lanes;
+        input += 16 * lanes;
+        output += 16 * lanes;
+        n -= lanes;
+    }
+}
+
+/*
+ * Decryption, with the equivalent inverse cipher schedule of aes128d_ctx.
+ *
+ * InvSubBytes reuses the forward circuit: with S(x) = A(x^-1) ^ 0x63 for
+ * the affine map A, S^-1(y) = B(S(B(y))) where B(y) = A^-1(y ^ 0x63)
+ * = y<<<1 ^ y<<<3 ^ y<<<6 ^ 0x05. Rotating every byte left by r takes plane
+ * (k + r) mod 8 to plane k, so B is three plane XORs and two NOTs.
+ */
+static BITSLICE_TARGET void InvAffine(__m128i q[8]) {
+    const __m128i ones = _mm_set1_epi8(-1);
+    __m128i y[8];
+
+    for (int k = 0; k < 8; ++k) {
+        y[k] = _mm_xor_si128(_mm_xor_si128(q[(k + 1) & 7], q[(k + 3) & 7]), q[(k + 6) & 7]);
+    }
+    // 0x05 sets bits 2 and 0, held by planes 5 and 7
+    y[5] = _mm_xor_si128(y[5], ones);
+    y[7] = _mm_xor_si128(y[7], ones);
+    memcpy(q, y, sizeof(y));
+}
+
+static BITSLICE_TARGET void InvSubBytes(__m128i q[8]) {
+    InvAffine(q);
+    SubBytes(q);
+    InvAffine(q);
+}
+
+// Byte p of the result is byte ISR[p] of the input, undoing ShiftRows
+static BITSLICE_TARGET void InvShiftRows(__m128i q[8]) {
+    const __m128i isr = _mm_setr_epi8(0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3);
+
+    for (int k = 0; k < 8; ++k) {
+        q[k] = _mm_shuffle_epi8(q[k], isr);
+    }
+}
+
+/*
+ * InvMixColumns factors as MixColumns(a ^ 4*(a ^ a<<<2)), as in aes128d.c,
+ * so it costs one MixColumns, one row rotation and two xtimes.
+ */
+static BITSLICE_TARGET void InvMixColumns(__m128i q[8]) {
+    const __m128i rot2 = _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    __m128i c[8], x[8];
+
+    for (int k = 0; k < 8; ++k) {
+        c[k] = _mm_xor_si128(q[k], _mm_shuffle_epi8(q[k], rot2));
+    }
+    xtime(x, c);
+    xtime(c, x);
+    for (int k = 0; k < 8; ++k) {
+        q[k] = _mm_xor_si128(q[k], c[k]);
+    }
+    MixColumns(q);
+}
+
+/*
+ * decrypt8 runs the ten rounds of the equivalent inverse cipher (FIPS-197
+ * section 5.3.5) over eight blocks already in plane form.
+ */
+static BITSLICE_TARGET void decrypt8(__m128i q[8], __m128i rk[11][8]) {
+    AddRoundKey(q, rk[0]);
+    for (int round = 1; round < 10; ++round) {
+        InvSubBytes(q);
+        InvShiftRows(q);
+        InvMixColumns(q);
+        AddRoundKey(q, rk[round]);
+    }
+    InvSubBytes(q);
+    InvShiftRows(q);
+    AddRoundKey(q, rk[10]);
+}
+
+/*
+ * aes128d_blocks_bitslice decrypts nblocks independent blocks eight at a
+ * time, padding the last group like aes128e_blocks_bitslice.
+ */
+BITSLICE_TARGET void aes128d_blocks_bitslice(const aes128d_ctx* ctx, uint8_t* output,
+                                             const uint8_t* input, size_t nblocks) {
+    __m128i rk[11][8];
+    __m128i q[8];
+
+    for (int round = 0; round <= 10; ++round) {
+        bitslice_round_key(rk[round], ctx->RoundKey + 16 * round);
+    }
+
+    while (nblocks > 0) {
+        size_t n = nblocks < 8 ? nblocks : 8;
+
+        for (size_t b = 0; b < 8; ++b) {
+            q[b] = b < n ? _mm_loadu_si128((const __m128i*) (input + 16 * b)) : _mm_setzero_si128();
+        }
+        transpose(q);
+        decrypt8(q, rk);
+        transpose(q);
+        for (size_t b = 0; b < n; ++b) {
+            _mm_storeu_si128((__m128i*) (output + 16 * b), q[b]);
+        }
+
+        input += 16 * n;
+        output += 16 * n;
+        nblocks -= n;
+    }
+}
+
+void aes128d_block_bitslice(const aes128d_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    aes128d_blocks_bitslice(ctx, output, input, 1);
+}
+
+/*
+ * SubBytes128 applies the S-box to 128 bytes at once by treating them as the
+ * eight block slots of the bitsliced circuit.
+ */
+static BITSLICE_TARGET void SubBytes128(uint8_t* bytes) {
+    __m128i q[8];
+
+    for (int b = 0; b < 8; ++b) {
+        q[b] = _mm_loadu_si128((const __m128i*) (bytes + 16 * b));
+    }
+    transpose(q);
+    SubBytes(q);
+    transpose(q);
+    for (int b = 0; b < 8; ++b) {
+        _mm_storeu_si128((__m128i*) (bytes + 16 * b), q[b]);
+    }
+}
+
+/*
+ * aes128_expand_keys_bitslice produces the FIPS-197 key schedules of n keys
+ * without any table lookup, 32 keys per pass: the rotated last words of all
+ * 32 schedules fill the 128 byte slots of one bitsliced S-box evaluation.
+ */
+BITSLICE_TARGET void aes128_expand_keys_bitslice(aes128_ctx* ctxs, const uint8_t* keys, size_t n) {
+    static const uint8_t Rcon[11] = { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36 };
+    uint8_t words[128] = {0};
+
+    while (n > 0) {
+        const size_t lanes = n < 32 ? n : 32;
+
+        for (size_t l = 0; l < lanes; ++l) {
+            memcpy(ctxs[l].RoundKey, keys + 16 * l, 16);
+        }
+
+        for (unsigned i = 4; i < 44; ++i) {
+            for (size_t l = 0; l < lanes; ++l) {
+                memcpy(words + 4 * l, ctxs[l].RoundKey + (i - 1) * 4, 4);
+            }
+
+            if (i % 4 == 0) {
+                // RotWord in every lane, then SubWord through the circuit
+                for (size_t l = 0; l < lanes; ++l) {
+                    const uint8_t u8tmp = words[4 * l];
+                    words[4 * l]     = words[4 * l + 1];
+                    words[4 * l + 1] = words[4 * l + 2];
+                    words[4 * l + 2] = words[4 * l + 3];
+                    words[4 * l + 3] = u8tmp;
+                }
+                SubBytes128(words);
+                for (size_t l = 0; l < lanes; ++l) {
+                    words[4 * l] ^= Rcon[i / 4];
+                }
+            }
+
+            for (size_t l = 0; l < lanes; ++l) {
+                for (unsigned j = 0; j < 4; ++j) {
+                    ctxs[l].RoundKey[i * 4 + j] = ctxs[l].RoundKey[(i - 4) * 4 + j] ^ words[4 * l + j];
+                }
+            }
+        }
+
+        ctxs += lanes;
+        keys += 16 * lanes;
+        n -= lanes;
+    }
+    ofb_wipe(words, sizeof(words));
+}
+
+void aes128_expand_key_bitslice(aes128_ctx* ctx, const uint8_t* key) {
+    aes128_expand_keys_bitslice(ctx, key, 1);
+}
+
+#else // !x86
+
+int aes128_bitslice_supported(void) {
+    return 0;
+}
+
+// Never selected on this architecture; present so the engine table links.
+void aes128_expand_key_bitslice(aes128_ctx* ctx, const uint8_t* key) {
+    (void) ctx; (void) key;
+}
+
+void aes128_expand_keys_bitslice(aes128_ctx* ctxs, const uint8_t* keys, size_t n) {
+    (void) ctxs; (void) keys; (void) n;
+}
+
+void aes128e_block_bitslice(const aes128_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    (void) ctx; (void) output; (void) input;
+}
+
+void aes128e_blocks_bitslice(const aes128_ctx* ctx, uint8_t* output,
+                             const uint8_t* input, size_t nblocks) {
+    (void) ctx; (void) output; (void) input; (void) nblocks;
+}
+
+void aes128e_multikey_bitslice(const aes128_ctx* const* ctxs, uint8_t* output,
+                               const uint8_t* input, size_t n) {
+    (void) ctxs; (void) output; (void) input; (void) n;
+}
+
+void aes128d_block_bitslice(const aes128d_ctx* ctx, uint8_t* output, const uint8_t* input) {
+    (void) ctx; (void) output; (void) input;
+}
+
+void aes128d_blocks_bitslice(const aes128d_ctx* ctx, uint8_t* output,
+                             const uint8_t* input, size_t nblocks) {
+    (void) ctx; (void) output; (void) input; (void) nblocks;
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * aes128e_impl.h
+ * --------------
+ * Internal declarations shared by the AES-128 engines in src/.
+ * Every engine works from the same 176-byte FIPS-197 key schedule held in
+ * aes128_ctx, so a context can be used with whichever engine is selected.
+ * This header is not part of the public interface in include/.
+ */
+#ifndef AES128E_IMPL_H
+#define AES128E_IMPL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../include/aes128e.h"
+#include "../include/aes128d.h"
+
+// Portable implementation on 32-bit columns, S-box table and SWAR MixColumns (aes128e.c)
+void aes128e_block_portable(const aes128_ctx *ctx, uint8_t *output, const uint8_t *input);
+
+// 32-bit T-table implementation (aes128e_ttable.c)
+void aes128e_block_ttable(const aes128_ctx *ctx, uint8_t *output, const uint8_t *input);
+void aes128e_blocks_ttable(const aes128_ctx *ctx, uint8_t *output, const uint8_t *input,
+                           size_t nblocks);
+
+// AES-NI implementation (aes128e_aesni.c); only valid when supported
+int  aes128_aesni_supported(void);
+void aes128_expand_key_aesni(aes128_ctx *ctx, const uint8_t *key);
+void aes128_expand_keys_aesni(aes128_ctx *ctxs, const uint8_t *keys, size_t n);
+void aes128e_block_aesni(const aes128_ctx *ctx, uint8_t *output, const uint8_t *input);
+void aes128e_blocks_aesni(const aes128_ctx *ctx, uint8_t *output, const uint8_t *input,
+                          size_t nblocks);
+void aes128e_multikey_aesni(const aes128_ctx *const *ctxs, uint8_t *output,
+                            const uint8_t *input, size_t n);
+void aes192e_block_aesni(const uint8_t *RoundKey, uint8_t *output, const uint8_t *input);
+void aes256e_block_aesni(const uint8_t *RoundKey, uint8_t *output, const uint8_t *input);
+
+// Constant-time bitsliced implementation, eight blocks per pass (aes128e_bitslice.c)
+int  aes128_bitslice_supported(void);
+void aes128_expand_key_bitslice(aes128_ctx *ctx, const uint8_t *key);
+void aes128_expand_keys_bitslice(aes128_ctx *ctxs, const uint8_t *keys, size_t n);
+void aes128e_block_bitslice(const aes128_ctx *ctx, uint8_t *output, const uint8_t *input);
+void aes128e_blocks_bitslice(const aes128_ctx *ctx, uint8_t *output, const uint8_t *input,
+                             size_t nblocks);
+void aes128e_multikey_bitslice(const aes128_ctx *const *ctxs, uint8_t *output,
+                               const uint8_t *input, size_t n);
+void aes128d_block_bitslice(const aes128d_ctx *ctx, uint8_t *output, const uint8_t *input);
+void aes128d_blocks_bitslice(const aes128d_ctx *ctx, uint8_t *output, const uint8_t *input,
+                             size_t nblocks);
+
+// Constant-time vector-permute (PSHUFB) implementation (aes128e_vpaes.c)
+int  aes128_vpaes_supported(void);
+void aes128_expand_key_vpaes(aes128_ctx *ctx, const uint8_t *key);
+void aes128_expand_keys_vpaes(aes128_ctx *ctxs, const uint8_t *keys, size_t n);
+void aes128e_block_vpaes(const aes128_ctx *ctx, uint8_t *output, const uint8_t *input);
+
+// Decryption with the equivalent inverse cipher (aes128d.c): Td tables, and
+// AESDEC/AESDECLAST (only valid when AES-NI is supported)
+void aes128d_block_table(const aes128d_ctx *ctx, uint8_t *output, const uint8_t *input);
+void aes128d_blocks_table(const aes128d_ctx *ctx, uint8_t *output, const uint8_t *input,
+                          size_t nblocks);
+void aes128d_block_aesni(const aes128d_ctx *ctx, uint8_t *output, const uint8_t *input);
+void aes128d_blocks_aesni(const aes128d_ctx *ctx, uint8_t *output, const uint8_t *input,
+                          size_t nblocks);
+
+#endif // AES128E_IMPL_H
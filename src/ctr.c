@@ -0,0 +1,270 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/aes128e.h"
+#include "../include/ctr.h"
+#include "ofb_secret.h"
+#include "ofb_xor.h"
+#include "workers.h"
+
+// Counter blocks encrypted per aes128e_blocks() call (4 KiB of keystream)
+#define CTR_SPAN_BLOCKS 256
+
+// Smallest share of an in-memory buffer worth a thread of its own
+#define CTR_MIN_RANGE (256 * 1024)
+
+// File ranges handed to workers, and the buffer each worker reads them through
+#define CTR_SEGMENT_SIZE (1024 * 1024)
+#define CTR_BUFFER_SIZE (64 * 1024)
+
+// Big-endian 64-bit loads and stores; a single BSWAP where the compiler has it
+static uint64_t load_be64(const uint8_t *p)
+{
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return __builtin_bswap64(v);
+#else
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v = v << 8 | p[i];
+    }
+    return v;
+#endif
+}
+
+static void store_be64(uint8_t *p, uint64_t v)
+{
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap64(v);
+    memcpy(p, &v, 8);
+#else
+    for (int i = 7; i >= 0; --i) {
+        p[i] = (uint8_t) v;
+        v >>= 8;
+    }
+#endif
+}
+
+/*
+ * counter_blocks writes the n counter blocks counter + block, ..., counter +
+ * block + n - 1 (big-endian, modulo 2^128) to out.
+ */
+static void counter_blocks(uint8_t *out, const uint8_t *counter, uint64_t block, size_t n)
+{
+    uint64_t hi = load_be64(counter), lo = load_be64(counter + 8) + block;
+
+    if (lo < block) {
+        ++hi;
+    }
+    for (size_t i = 0; i < n; ++i, out += 16) {
+        store_be64(out, hi);
+        store_be64(out + 8, lo);
+        if (++lo == 0) {
+            ++hi;
+        }
+    }
+}
+
+/*
+ * crypt_blocks XORs nblocks whole blocks, starting at keystream block
+ * `block`, a span of counter blocks at a time through the batched AES path.
+ */
+static void crypt_blocks(const ctr_ctx *ctx, uint8_t *out, const uint8_t *in, uint64_t block,
+                         size_t nblocks, int stream)
+{
+    const size_t span = nblocks < CTR_SPAN_BLOCKS ? nblocks : CTR_SPAN_BLOCKS;
+    _Alignas(64) uint8_t keystream[CTR_SPAN_BLOCKS * 16];
+
+    while (nblocks > 0) {
+        size_t n = nblocks < CTR_SPAN_BLOCKS ? nblocks : CTR_SPAN_BLOCKS;
+
+        counter_blocks(keystream, ctx->counter, block, n);
+        aes128e_blocks(&ctx->key, keystream, keystream, n);
+        if (stream) {
+            ofb_xor_stream(out, in, keystream, 16 * n);
+        } else {
+            ofb_xor(out, in, keystream, 16 * n);
+        }
+        out += 16 * n;
+        in += 16 * n;
+        block += n;
+        nblocks -= n;
+    }
+    ofb_wipe(keystream, 16 * span);
+}
+
+void ctr_init(ctr_ctx *ctx, const uint8_t *key, const uint8_t *counter)
+{
+    aes128_init(&ctx->key, key);
+    memcpy(ctx->counter, counter, 16);
+    ctx->offset = 0;
+}
+
+void ctr_seek(ctr_ctx *ctx, uint64_t offset)
+{
+    ctx->offset = offset;
+
+    // Inside a block, ctr_update() continues from the rest of its keystream
+    if (offset % 16) {
+        counter_blocks(ctx->keystream, ctx->counter, offset / 16, 1);
+        aes128e_block(&ctx->key, ctx->keystream, ctx->keystream);
+    }
+}
+
+void ctr_update(ctr_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len)
+{
+    const unsigned pos = (unsigned) (ctx->offset % 16);
+
+    // Finish the current block
+    if (pos && len > 0) {
+        size_t n = 16 - pos < len ? 16 - pos : len;
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = in[i] ^ ctx->keystream[pos + i];
+        }
+        out += n;
+        in += n;
+        len -= n;
+        ctx->offset += n;
+    }
+
+    // Whole blocks, then a trailing partial block whose keystream is kept
+    size_t blocks = len / 16;
+    if (blocks > 0) {
+        crypt_blocks(ctx, out, in, ctx->offset / 16, blocks, ofb_xor_streaming(out, in, len));
+        out += 16 * blocks;
+        in += 16 * blocks;
+        len -= 16 * blocks;
+        ctx->offset += 16 * blocks;
+    }
+    if (len > 0) {
+        ctr_seek(ctx, ctx->offset + len);
+        for (size_t i = 0; i < len; ++i) {
+            out[i] = in[i] ^ ctx->keystream[i];
+        }
+    }
+}
+
+void ctr_final(ctr_ctx *ctx)
+{
+    ofb_wipe(ctx, sizeof(*ctx));
+}
+
+void CTRaes128e(uint8_t *ciphertext, const uint8_t *plaintext, size_t length,
+                uint8_t *counter, const uint8_t *key)
+{
+    ctr_ctx ctx;
+
+    ctr_init(&ctx, key, counter);
+    ctr_update(&ctx, ciphertext, plaintext, length);
+    ctr_final(&ctx);
+    counter_blocks(counter, counter, (length + 15) / 16, 1);
+}
+
+/*
+ * In-memory parallelism: the buffer is cut into one contiguous counter range
+ * per thread, each processed by its own copy of the stream seeked to the
+ * start of the range.
+ */
+typedef struct {
+    const ctr_ctx *ctx;
+    uint8_t *out;
+    const uint8_t *in;
+    size_t len, share;
+    unsigned ranges;
+} range_job;
+
+static int crypt_range(void *arg, uint64_t range, uint8_t *buffer)
+{
+    const range_job *job = arg;
+    const size_t start = (size_t) range * job->share;
+    ctr_ctx local = *job->ctx;
+
+    (void) buffer;
+    ctr_seek(&local, job->ctx->offset + start);
+    ctr_update(&local, job->out + start, job->in + start,
+               range + 1 < job->ranges ? job->share : job->len - start);
+    ctr_final(&local);
+    return 0;
+}
+
+void ctr_update_parallel(ctr_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len, unsigned threads)
+{
+    if (threads > len / CTR_MIN_RANGE) {
+        threads = (unsigned) (len / CTR_MIN_RANGE);
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+    if (threads <= 1) {
+        ctr_update(ctx, out, in, len);
+        return;
+    }
+
+    // Whole blocks per range, the remainder going to the last one
+    range_job job = {
+        .ctx = ctx, .out = out, .in = in, .len = len, .share = len / threads / 16 * 16, .ranges = threads,
+    };
+    run_segments(crypt_range, &job, threads, 0, threads);
+    ctr_seek(ctx, ctx->offset + len);
+}
+
+/*
+ * File parallelism: segment s covers stream offsets [offset + s * SEGMENT,
+ * offset + (s + 1) * SEGMENT), each processed by a copy of the stream seeked
+ * to its start; the key is expanded once.
+ */
+typedef struct {
+    int in_fd, out_fd;
+    const ctr_ctx *ctx;
+    uint64_t offset, length;
+} crypt_job;
+
+static int crypt_segment(void *arg, uint64_t segment, uint8_t *buffer)
+{
+    const crypt_job *job = arg;
+    uint64_t pos = segment * CTR_SEGMENT_SIZE;
+    uint64_t end = pos + CTR_SEGMENT_SIZE < job->length ? pos + CTR_SEGMENT_SIZE : job->length;
+    ctr_ctx ctx = *job->ctx;
+    int result = 0;
+
+    ctr_seek(&ctx, job->offset + pos);
+    while (pos < end && result == 0) {
+        size_t n = end - pos < CTR_BUFFER_SIZE ? (size_t) (end - pos) : CTR_BUFFER_SIZE;
+        if (pread(job->in_fd, buffer, n, (off_t) (job->offset + pos)) != (ssize_t) n) {
+            result = -1;
+            break;
+        }
+        ctr_update(&ctx, buffer, buffer, n);
+        if (pwrite(job->out_fd, buffer, n, (off_t) pos) != (ssize_t) n) {
+            result = -1;
+        }
+        pos += n;
+    }
+    ctr_final(&ctx);
+    return result;
+}
+
+int ctr_crypt_fd(int in_fd, int out_fd, const uint8_t *key, const uint8_t *counter,
+                 uint64_t offset, uint64_t length, unsigned threads)
+{
+    struct stat st;
+    ctr_ctx ctx;
+    crypt_job job = { .in_fd = in_fd, .out_fd = out_fd, .ctx = &ctx, .offset = offset, .length = length };
+
+    if (fstat(in_fd, &st) != 0) {
+        return -1;
+    }
+    if (offset > (uint64_t) st.st_size || length > (uint64_t) st.st_size - offset) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ctr_init(&ctx, key, counter);
+    int result = run_segments(crypt_segment, &job, (length + CTR_SEGMENT_SIZE - 1) / CTR_SEGMENT_SIZE,
+                              CTR_BUFFER_SIZE, threads);
+    ctr_final(&ctx);
+    return result;
+}
@@ -0,0 +1,425 @@
+#include <string.h>
+#include "../include/aes128e.h"
+#include "../include/gcm.h"
+#include "gcm_impl.h"
+#include "ofb_secret.h"
+#include "ofb_xor.h"
+
+/*
+ * AES-128-GCM
+ * -----------
+ * The text of a message is processed as whole blocks where possible: the
+ * stitched AES-NI/PCLMULQDQ loop when both are in use, otherwise a span of
+ * CTR keystream through aes128e_blocks() followed by GHASH of the span.
+ * Bytes of a block in progress are kept in ctx->partial (for GHASH) and
+ * ctx->keystream, which stay in step: partial_len is text_len % 16.
+ */
+
+// Counter blocks encrypted per aes128e_blocks() call when not stitched
+#define GCM_SPAN_BLOCKS 64
+
+/*
+ * GHASH backend, chosen once at program start: PCLMULQDQ if the CPU has it,
+ * else 4-bit tables.
+ */
+static void (*ghash_init)(uint8_t *, const uint8_t *) = ghash_init_table;
+static void (*ghash_blocks)(const uint8_t *, uint8_t *, const uint8_t *, size_t) = ghash_blocks_table;
+static int clmul;
+
+__attribute__((constructor)) static void resolve_ghash(void)
+{
+    if (ghash_clmul_supported()) {
+        ghash_init = ghash_init_clmul;
+        ghash_blocks = ghash_blocks_clmul;
+        clmul = 1;
+    }
+}
+
+/*
+ * Shoup's 4-bit method: M[i] = i * H for every 4-bit i, and last4[r] the
+ * reduction of the four bits shifted out of the low end by one nibble step.
+ * The table is kept as the high and low 64-bit halves of each multiple.
+ */
+static const uint64_t last4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+static uint64_t get_be64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v = v << 8 | p[i];
+    }
+    return v;
+}
+
+static void put_be64(uint8_t *p, uint64_t v)
+{
+    for (int i = 7; i >= 0; --i) {
+        p[i] = (uint8_t) v;
+        v >>= 8;
+    }
+}
+
+void ghash_init_table(uint8_t *hkey, const uint8_t *h)
+{
+    uint64_t hh[16] = {0}, hl[16] = {0};
+    uint64_t vh = get_be64(h), vl = get_be64(h + 8);
+
+    // H at index 8, then H * x, H * x^2, H * x^3 (bit order is reflected)
+    hh[8] = vh;
+    hl[8] = vl;
+    for (int i = 4; i > 0; i >>= 1) {
+        uint64_t t = (vl & 1) * 0xe100000000000000ULL;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ t;
+        hh[i] = vh;
+        hl[i] = vl;
+    }
+    // The other multiples are sums of those four
+    for (int i = 2; i <= 8; i *= 2) {
+        for (int j = 1; j < i; ++j) {
+            hh[i + j] = hh[i] ^ hh[j];
+            hl[i + j] = hl[i] ^ hl[j];
+        }
+    }
+    memcpy(hkey, hh, sizeof(hh));
+    memcpy(hkey + sizeof(hh), hl, sizeof(hl));
+}
+
+void ghash_blocks_table(const uint8_t *hkey, uint8_t *x, const uint8_t *in, size_t nblocks)
+{
+    uint64_t hh[16], hl[16];
+    uint8_t y[16];
+
+    memcpy(hh, hkey, sizeof(hh));
+    memcpy(hl, hkey + sizeof(hh), sizeof(hl));
+    for (; nblocks > 0; --nblocks, in += 16) {
+        for (int i = 0; i < 16; ++i) {
+            y[i] = x[i] ^ in[i];
+        }
+
+        // Z = Y * H, one nibble at a time from the low end of Y
+        unsigned lo = y[15] & 0xf, hi, rem;
+        uint64_t zh = hh[lo], zl = hl[lo];
+        for (int i = 15; i >= 0; --i) {
+            lo = y[i] & 0xf;
+            hi = y[i] >> 4;
+            if (i != 15) {
+                rem = (unsigned) zl & 0xf;
+                zl = (zh << 60) | (zl >> 4);
+                zh = (zh >> 4) ^ (last4[rem] << 48);
+                zh ^= hh[lo];
+                zl ^= hl[lo];
+            }
+            rem = (unsigned) zl & 0xf;
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ (last4[rem] << 48);
+            zh ^= hh[hi];
+            zl ^= hl[hi];
+        }
+        put_be64(x, zh);
+        put_be64(x + 8, zl);
+    }
+}
+
+// Increments the last 32 bits of a counter block (inc32 of SP 800-38D)
+static void inc32(uint8_t *counter)
+{
+    for (int i = 15; i >= 12 && ++counter[i] == 0; --i) {
+    }
+}
+
+// GHASH of len bytes, the last block padded with zeros
+static void ghash_padded(const uint8_t *hkey, uint8_t *x, const uint8_t *data, size_t len)
+{
+    uint8_t block[16] = {0};
+
+    ghash_blocks(hkey, x, data, len / 16);
+    if (len % 16) {
+        memcpy(block, data + len / 16 * 16, len % 16);
+        ghash_blocks(hkey, x, block, 1);
+    }
+}
+
+// Absorbs the block in progress, zero-padded
+static void flush_partial(gcm_ctx *ctx)
+{
+    if (ctx->partial_len > 0) {
+        memset(ctx->partial + ctx->partial_len, 0, 16 - ctx->partial_len);
+        ghash_blocks(ctx->hkey, ctx->x, ctx->partial, 1);
+        ctx->partial_len = 0;
+    }
+}
+
+void gcm_init(gcm_ctx *ctx, const uint8_t *key)
+{
+    uint8_t h[16] = {0};
+
+    memset(ctx, 0, sizeof(*ctx));
+    aes128_init(&ctx->key, key);
+    aes128e_block(&ctx->key, h, h);
+    ghash_init(ctx->hkey, h);
+    ofb_wipe(h, sizeof(h));
+}
+
+int gcm_start(gcm_ctx *ctx, const uint8_t *iv, size_t iv_len)
+{
+    uint8_t lengths[16] = {0};
+
+    if (iv_len == 0) {
+        return -1;
+    }
+    memset(ctx->x, 0, 16);
+    ctx->partial_len = 0;
+    ctx->aad_len = ctx->text_len = 0;
+
+    // J0 = IV || 0^31 || 1 for a 96-bit IV, else GHASH(IV || pad || [len(IV)]_64)
+    if (iv_len == 12) {
+        memcpy(ctx->j0, iv, 12);
+        memset(ctx->j0 + 12, 0, 4);
+        ctx->j0[15] = 1;
+    } else {
+        memset(ctx->j0, 0, 16);
+        ghash_padded(ctx->hkey, ctx->j0, iv, iv_len);
+        put_be64(lengths + 8, (uint64_t) iv_len * 8);
+        ghash_blocks(ctx->hkey, ctx->j0, lengths, 1);
+    }
+    memcpy(ctx->counter, ctx->j0, 16);
+    inc32(ctx->counter);
+    return 0;
+}
+
+int gcm_aad(gcm_ctx *ctx, const uint8_t *aad, size_t len)
+{
+    if (ctx->text_len > 0 || len > GCM_MAX_AAD_LEN - ctx->aad_len) {
+        return -1;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    ctx->aad_len += len;
+
+    if (ctx->partial_len > 0) {
+        size_t n = 16 - ctx->partial_len < len ? 16 - ctx->partial_len : len;
+        memcpy(ctx->partial + ctx->partial_len, aad, n);
+        ctx->partial_len += (unsigned) n;
+        aad += n;
+        len -= n;
+        if (ctx->partial_len < 16) {
+            return 0;
+        }
+        ghash_blocks(ctx->hkey, ctx->x, ctx->partial, 1);
+        ctx->partial_len = 0;
+    }
+    ghash_blocks(ctx->hkey, ctx->x, aad, len / 16);
+    memcpy(ctx->partial, aad + len / 16 * 16, len % 16);
+    ctx->partial_len = (unsigned) (len % 16);
+    return 0;
+}
+
+/*
+ * crypt_blocks handles whole blocks: stitched when the AES-NI engine and
+ * PCLMULQDQ are both in use, otherwise CTR spans and then GHASH.
+ */
+static void crypt_blocks(gcm_ctx *ctx, uint8_t *out, const uint8_t *in, size_t nblocks, int decrypt)
+{
+    const size_t span = nblocks < GCM_SPAN_BLOCKS ? nblocks : GCM_SPAN_BLOCKS;
+    _Alignas(64) uint8_t keystream[GCM_SPAN_BLOCKS * 16];
+
+    if (clmul && aes128_get_backend() == AES128_BACKEND_AESNI) {
+        gcm_crypt_clmul(&ctx->key, ctx->hkey, ctx->x, ctx->counter, out, in, nblocks, decrypt);
+        return;
+    }
+    while (nblocks > 0) {
+        size_t n = nblocks < GCM_SPAN_BLOCKS ? nblocks : GCM_SPAN_BLOCKS;
+
+        for (size_t i = 0; i < n; ++i) {
+            memcpy(keystream + 16 * i, ctx->counter, 16);
+            inc32(ctx->counter);
+        }
+        aes128e_blocks(&ctx->key, keystream, keystream, n);
+
+        // GHASH covers the ciphertext, read before an in-place XOR when decrypting
+        if (decrypt) {
+            ghash_blocks(ctx->hkey, ctx->x, in, n);
+        }
+        ofb_xor(out, in, keystream, 16 * n);
+        if (!decrypt) {
+            ghash_blocks(ctx->hkey, ctx->x, out, n);
+        }
+        out += 16 * n;
+        in += 16 * n;
+        nblocks -= n;
+    }
+    ofb_wipe(keystream, 16 * span);
+}
+
+/*
+ * update checks the length first: past GCM_MAX_TEXT_LEN the counter would
+ * wrap around to blocks already used (in inc32 and the stitched PADDD alike)
+ * and repeat keystream.
+ */
+static int update(gcm_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len, int decrypt)
+{
+    if (len > GCM_MAX_TEXT_LEN - ctx->text_len) {
+        return -1;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    if (ctx->text_len == 0) {
+        flush_partial(ctx);  // the end of the AAD
+    }
+    ctx->text_len += len;
+
+    // Finish the block in progress
+    const unsigned pos = ctx->partial_len;
+    if (pos > 0) {
+        size_t n = 16 - pos < len ? 16 - pos : len;
+        if (decrypt) {
+            memcpy(ctx->partial + pos, in, n);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = in[i] ^ ctx->keystream[pos + i];
+        }
+        if (!decrypt) {
+            memcpy(ctx->partial + pos, out, n);
+        }
+        ctx->partial_len += (unsigned) n;
+        out += n;
+        in += n;
+        len -= n;
+        if (ctx->partial_len == 16) {
+            ghash_blocks(ctx->hkey, ctx->x, ctx->partial, 1);
+            ctx->partial_len = 0;
+        }
+    }
+
+    size_t blocks = len / 16;
+    if (blocks > 0) {
+        crypt_blocks(ctx, out, in, blocks, decrypt);
+        out += 16 * blocks;
+        in += 16 * blocks;
+        len -= 16 * blocks;
+    }
+
+    // Start a block for the trailing bytes
+    if (len > 0) {
+        aes128e_block(&ctx->key, ctx->keystream, ctx->counter);
+        inc32(ctx->counter);
+        if (decrypt) {
+            memcpy(ctx->partial, in, len);
+        }
+        for (size_t i = 0; i < len; ++i) {
+            out[i] = in[i] ^ ctx->keystream[i];
+        }
+        if (!decrypt) {
+            memcpy(ctx->partial, out, len);
+        }
+        ctx->partial_len = (unsigned) len;
+    }
+    return 0;
+}
+
+int gcm_encrypt(gcm_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len)
+{
+    return update(ctx, out, in, len, 0);
+}
+
+int gcm_decrypt(gcm_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len)
+{
+    return update(ctx, out, in, len, 1);
+}
+
+void gcm_finish(gcm_ctx *ctx, uint8_t *tag, size_t tag_len)
+{
+    uint8_t lengths[16], full[16];
+
+    flush_partial(ctx);
+    put_be64(lengths, ctx->aad_len * 8);
+    put_be64(lengths + 8, ctx->text_len * 8);
+    ghash_blocks(ctx->hkey, ctx->x, lengths, 1);
+
+    aes128e_block(&ctx->key, full, ctx->j0);
+    ofb_xor_block(full, full, ctx->x);
+    memcpy(tag, full, tag_len < 16 ? tag_len : 16);
+
+    // Keep the key; the message state goes
+    ofb_wipe(full, sizeof(full));
+    ofb_wipe(ctx->x, sizeof(ctx->x));
+    ofb_wipe(ctx->keystream, sizeof(ctx->keystream));
+    ofb_wipe(ctx->partial, sizeof(ctx->partial));
+}
+
+// The message is ended either way; a tag length not allowed never matches
+static int verify(gcm_ctx *ctx, const uint8_t *tag, size_t tag_len, int allow_short)
+{
+    uint8_t computed[16], diff = 0;
+    const int allowed = (tag_len >= 12 && tag_len <= 16) ||
+                        (allow_short && (tag_len == 8 || tag_len == 4));
+
+    gcm_finish(ctx, computed, 16);
+    if (!allowed) {
+        ofb_wipe(computed, sizeof(computed));
+        return -1;
+    }
+    for (size_t i = 0; i < tag_len; ++i) {
+        diff |= computed[i] ^ tag[i];
+    }
+    ofb_wipe(computed, sizeof(computed));
+    return diff ? -1 : 0;
+}
+
+int gcm_verify(gcm_ctx *ctx, const uint8_t *tag, size_t tag_len)
+{
+    return verify(ctx, tag, tag_len, 0);
+}
+
+int gcm_verify_short(gcm_ctx *ctx, const uint8_t *tag, size_t tag_len)
+{
+    return verify(ctx, tag, tag_len, 1);
+}
+
+void gcm_final(gcm_ctx *ctx)
+{
+    ofb_wipe(ctx, sizeof(*ctx));
+}
+
+int aes128_gcm_encrypt(uint8_t *ciphertext, uint8_t *tag, const uint8_t *plaintext, size_t len,
+                       const uint8_t *aad, size_t aad_len,
+                       const uint8_t *iv, size_t iv_len, const uint8_t *key)
+{
+    gcm_ctx ctx;
+    int result;
+
+    gcm_init(&ctx, key);
+    result = gcm_start(&ctx, iv, iv_len) == 0 && gcm_aad(&ctx, aad, aad_len) == 0 &&
+             gcm_encrypt(&ctx, ciphertext, plaintext, len) == 0 ? 0 : -1;
+    if (result == 0) {
+        gcm_finish(&ctx, tag, 16);
+    }
+    gcm_final(&ctx);
+    return result;
+}
+
+int aes128_gcm_decrypt(uint8_t *plaintext, const uint8_t *ciphertext, size_t len,
+                       const uint8_t *aad, size_t aad_len, const uint8_t *tag,
+                       const uint8_t *iv, size_t iv_len, const uint8_t *key)
+{
+    gcm_ctx ctx;
+
+    gcm_init(&ctx, key);
+    if (gcm_start(&ctx, iv, iv_len) != 0 || gcm_aad(&ctx, aad, aad_len) != 0 ||
+        gcm_decrypt(&ctx, plaintext, ciphertext, len) != 0) {
+        gcm_final(&ctx);
+        return -1;
+    }
+    int result = gcm_verify(&ctx, tag, 16);
+    gcm_final(&ctx);
+    if (result != 0) {
+        memset(plaintext, 0, len);
+    }
+    return result;
+}
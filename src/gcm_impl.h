@@ -0,0 +1,34 @@
+/*
+ * gcm_impl.h
+ * ----------
+ * Internal GHASH and stitched CTR+GHASH kernels behind gcm.c. Blocks are in
+ * the GCM byte order of SP 800-38D throughout; each GHASH backend keeps its
+ * key (the 256-byte hkey of gcm_ctx) in its own format, so a key must be
+ * used with the backend that set it up. This header is not part of the
+ * public interface in include/.
+ */
+#ifndef GCM_IMPL_H
+#define GCM_IMPL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../include/aes128e.h"
+
+// Shoup's 4-bit tables (gcm.c): 16 multiples of H
+void ghash_init_table(uint8_t *hkey, const uint8_t *h);
+void ghash_blocks_table(const uint8_t *hkey, uint8_t *x, const uint8_t *in, size_t nblocks);
+
+// PCLMULQDQ (gcm_clmul.c): H^1..H^8, only valid when supported
+int  ghash_clmul_supported(void);
+void ghash_init_clmul(uint8_t *hkey, const uint8_t *h);
+void ghash_blocks_clmul(const uint8_t *hkey, uint8_t *x, const uint8_t *in, size_t nblocks);
+
+/*
+ * CTR+GHASH over nblocks whole blocks with AES-NI and PCLMULQDQ in one loop:
+ * out = in ^ E_K(counter++), and x absorbs the ciphertext (out when
+ * encrypting, in when decrypting). counter is advanced with inc32.
+ */
+void gcm_crypt_clmul(const aes128_ctx *key, const uint8_t *hkey, uint8_t *x, uint8_t *counter,
+                     uint8_t *out, const uint8_t *in, size_t nblocks, int decrypt);
+
+#endif // GCM_IMPL_H
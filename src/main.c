@@ -7,15 +7,69 @@
 * Usage:
 *   ./aes_ofb -e input.txt encrypted.bin key.bin iv.bin     // Encrypt a file
 *   ./aes_ofb -d encrypted.bin output.txt key.bin iv.bin    // Decrypt a file
+*   ./aes_ofb -g reservoir.ks 1G key.bin iv.bin             // Pre-generate keystream
+*   ./aes_ofb -e --reservoir reservoir.ks input.txt encrypted.bin
+*                                        // Encrypt with pre-generated keystream; the
+*                                        // masked IV to decrypt with goes to encrypted.bin.iv
+*   ./aes_ofb -d --reservoir-iv encrypted.bin output.txt key.bin encrypted.bin.iv
+*   ./aes_ofb -e --index enc.idx input.txt encrypted.bin key.bin iv.bin
+*   ./aes_ofb -d --index enc.idx encrypted.bin output.txt key.bin iv.bin
+*                                        // Checkpoint index for parallel decryption
+*   ./aes_ofb -d --index enc.idx --offset 1G --length 4K encrypted.bin part.txt key.bin iv.bin
+*                                        // Decrypt only a byte range
+*   ./aes_ofb -e --append log.state entry.txt log.bin key.bin iv.bin
+*                                        // Encrypt onto the end of log.bin
+*   ./aes_ofb -e --mac mac.bin input.txt encrypted.bin key.bin iv.bin
+*   ./aes_ofb -d --mac mac.bin encrypted.bin output.txt key.bin iv.bin
+*                                        // CMAC tag in encrypted.bin.tag, checked on -d
+*   ./aes_ofb -e -m ctr input.txt encrypted.bin key.bin iv.bin
+*                                        // CTR mode on all cores (iv.bin: initial counter)
+*   ./aes_ofb -e -m xts --sector-size 4K disk.img disk.enc key.bin tweak.bin
+*                                        // XTS by sector on all cores (tweak.bin: tweak key)
+*
+* Options:
+*   --pipeline   generate the keystream on a background thread (ofb_pipe.h)
+*   --reservoir  XOR against a keystream reservoir instead of running AES (ofb_reservoir.h)
+*   --reservoir-iv  the IV file is a masked IV written by --reservoir
+*   --index      write (-e) or use (-d) a checkpoint index (ofb_index.h)
+*   --interval   bytes between checkpoints when writing an index (default 16M)
+*   --threads    threads for -m ctr/xts and indexed decryption, 1 to 64 (default: all cores)
+*   --offset     first byte of the range to process (default 0)
+*   --length     bytes in the range (default: to the end of the input)
+*   --append     continue the stream saved in a state file (ofb_state.h)
+*   --mac        authenticate the IV and ciphertext with AES-CMAC in the same pass (ofb_cmac.h)
+*   -m <mode>    ofb (default), ctr (ctr.h) or xts (xts.h)
+*   --sector-size  XTS sector size (default 512)
 *
 */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "../include/aes128e.h"
 #include "../include/obf.h"
+#include "../include/ofb_pipe.h"
+#include "../include/ofb_reservoir.h"
+#include "../include/ofb_index.h"
+#include "../include/ofb_state.h"
+#include "../include/ofb_cmac.h"
+#include "../include/ctr.h"
+#include "../include/xts.h"
+#include "workers.h"
+
+// Bytes read, encrypted and written per step (a multiple of the block size)
+#define STREAM_BUFFER_SIZE (64 * 1024)
+
+// Default distance between checkpoints of an index
+#define DEFAULT_INDEX_INTERVAL (16 * 1024 * 1024)
+
+// Default XTS sector size
+#define DEFAULT_SECTOR_SIZE 512
 
 void print_hex(const char* label, const uint8_t* data, uint32_t len) {
     printf("%s: ", label);
@@ -25,99 +79,645 @@ void print_hex(const char* label, const uint8_t* data, uint32_t len) {
     printf("\n");
 }
 
-int main(int argc, char* argv[]) {
-    if (argc != 6) {
-        fprintf(stderr, "Usage: %s <-e|-d> <input_file> <output_file> <key_file> <iv_file>\n", argv[0]);
-        return 1;
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s <-e|-d> [--pipeline] <input_file> <output_file> <key_file> <iv_file>\n"
+                    "       %s -e --reservoir <reservoir_file> <input_file> <output_file>\n"
+                    "       %s -g <reservoir_file> <size[K|M|G]> <key_file> <iv_file>\n"
+                    "  -m <ofb|ctr|xts>    cipher mode (default ofb); ctr and xts run on --threads cores\n"
+                    "                      and support --offset/--length without an index; for xts\n"
+                    "                      <iv_file> holds the tweak key\n"
+                    "  --sector-size <size> xts sector size, a multiple of 16 (default 512)\n"
+                    "  --pipeline   generate the keystream on a background thread\n"
+                    "  --reservoir  encrypt with keystream pre-generated by -g; the masked IV\n"
+                    "               needed to decrypt is written to <output_file>.iv\n"
+                    "  --reservoir-iv  -d: <iv_file> is a masked IV written by --reservoir\n"
+                    "  --index <file>      -e: write a checkpoint index; -d: decrypt in parallel with it\n"
+                    "  --interval <size>   bytes between checkpoints (default 16M)\n"
+                    "  --threads <n>       threads for ctr, xts and --index, 1-64 (default: all cores)\n"
+                    "  --offset <size>     process only the range starting at this byte; with\n"
+                    "                      --index it starts from the nearest checkpoint\n"
+                    "  --length <size>     bytes in the range (default: to the end of the input)\n"
+                    "  --append <state>    -e: add to the end of <output_file>, continuing the stream\n"
+                    "                      saved in <state> (created on first use)\n"
+                    "  --mac <key_file>    -e: write the AES-CMAC of the IV and ciphertext to <output_file>.tag;\n"
+                    "                      -d: check <input_file>.tag; the output is only created if it matches\n",
+            prog, prog, prog);
+}
+
+/*
+ * read_block_file reads a key or IV file, which must hold exactly 16 bytes.
+ */
+static int read_block_file(const char* path, uint8_t* out, const char* what) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror("Error opening files");
+        return -1;
     }
 
-    int encrypt = strcmp(argv[1], "-e") == 0;
-    if (!encrypt && strcmp(argv[1], "-d") != 0) {
-        fprintf(stderr, "Invalid mode '%s'. Use -e to encrypt or -d to decrypt.\n", argv[1]);
-        return 1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    if (size != 16) {
+        fprintf(stderr, "❌ Error: %s must be exactly 16 bytes (got %ld bytes).\n", what, size);
+        fclose(f);
+        return -1;
     }
 
-    FILE *fin = fopen(argv[2], "rb");
-    FILE *fout = fopen(argv[3], "wb");
-    FILE *fkey = fopen(argv[4], "rb");
-    FILE *fiv = fopen(argv[5], "rb");
-    if (!fin || !fout || !fkey || !fiv) {
+    size_t bytes_read = fread(out, 1, 16, f);
+    int extra_byte = fgetc(f);
+    fclose(f);
+    if (bytes_read != 16 || extra_byte != EOF) {
+        fprintf(stderr, "❌ Error: %s file must contain exactly 16 bytes (no more, no less).\n", what);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * parse_size reads a byte count with an optional K, M or G (binary) suffix.
+ */
+static int parse_size(const char* text, uint64_t* size) {
+    char* end;
+    unsigned long long value = strtoull(text, &end, 10);
+    int shift = 0;
+
+    switch (*end) {
+    case 'K': case 'k': shift = 10; ++end; break;
+    case 'M': case 'm': shift = 20; ++end; break;
+    case 'G': case 'g': shift = 30; ++end; break;
+    }
+    if (end == text || *end != '\0' || text[0] == '-' || value > (UINT64_MAX >> shift)) {
+        return -1;
+    }
+    *size = (uint64_t) value << shift;
+    return 0;
+}
+
+/*
+ * parse_threads reads a thread count: decimal digits only, from 1 to MAX_THREADS.
+ */
+static int parse_threads(const char* text, long* threads) {
+    char* end;
+
+    errno = 0;
+    long value = strtol(text, &end, 10);
+    if (text[0] < '0' || text[0] > '9' || *end != '\0' || errno == ERANGE ||
+        value < 1 || value > MAX_THREADS) {
+        return -1;
+    }
+    *threads = value;
+    return 0;
+}
+
+/*
+ * decrypt_indexed decrypts in_path into out_path with the checkpoints of an
+ * index, one segment per thread.
+ */
+static int decrypt_indexed(const char* index_path, const char* in_path, const char* out_path,
+                           const uint8_t* key, const uint8_t* iv, unsigned threads) {
+    ofb_index index;
+
+    if (ofb_index_load(index_path, &index, key, iv) != 0) {
+        perror("Error reading index");
+        return -1;
+    }
+    int in_fd = open(in_path, O_RDONLY);
+    int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int result = -1;
+    if (in_fd < 0 || out_fd < 0) {
         perror("Error opening files");
-        return 1;
+    } else if (ofb_index_decrypt(in_fd, out_fd, &index, key, iv, threads) != 0) {
+        perror("Error decrypting");
+    } else {
+        result = 0;
+    }
+    if (in_fd >= 0) close(in_fd);
+    if (out_fd >= 0 && close(out_fd) != 0) result = -1;
+    ofb_index_free(&index);
+    return result;
+}
+
+/*
+ * process_range decrypts (or encrypts) length bytes of in_path starting at
+ * offset into out_path. With an index only the keystream from the nearest
+ * checkpoint onward is generated.
+ */
+static int process_range(const char* index_path, const char* in_path, const char* out_path,
+                         const uint8_t* key, const uint8_t* iv, uint64_t offset, uint64_t length) {
+    static uint8_t buffer[STREAM_BUFFER_SIZE];
+    ofb_index index;
+    ofb_reader reader;
+    size_t n;
+
+    if (index_path && ofb_index_load(index_path, &index, key, iv) != 0) {
+        perror("Error reading index");
+        return -1;
+    }
+    FILE* fin = fopen(in_path, "rb");
+    FILE* fout = fopen(out_path, "wb");
+    int failed = !fin || !fout || fseeko(fin, (off_t) offset, SEEK_SET) != 0;
+    if (failed) {
+        perror("Error opening files");
+    } else {
+        ofb_reader_init(&reader, key, iv, index_path ? &index : NULL);
+        ofb_seek(&reader, offset);
+        while (length > 0 && (n = fread(buffer, 1, length < sizeof(buffer) ? length : sizeof(buffer), fin)) > 0) {
+            ofb_read(&reader, buffer, buffer, n);
+            if (fwrite(buffer, 1, n, fout) != n) {
+                break;
+            }
+            length -= n;
+        }
+        ofb_reader_final(&reader);
+        failed = ferror(fin) || ferror(fout);
+    }
+    if (fin) fclose(fin);
+    if (fout && fclose(fout) != 0) failed = 1;
+    if (index_path) ofb_index_free(&index);
+    return failed ? -1 : 0;
+}
+
+/*
+ * encrypt_reservoir encrypts fin into fout by XOR with the next keystream of a
+ * reservoir and saves the masked IV that decrypts it to iv_path.
+ */
+static int encrypt_reservoir(const char* reservoir, FILE* fin, FILE* fout, const char* iv_path) {
+    static uint8_t buffer[STREAM_BUFFER_SIZE];
+    uint8_t iv[16];
+    struct stat st;
+    size_t n;
+
+    // The keystream is reserved up front, so the length must be known
+    if (fstat(fileno(fin), &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "❌ Error: --reservoir input must be a regular file.\n");
+        return -1;
+    }
+    uint64_t length = (uint64_t) st.st_size;
+
+    ofb_reservoir* res = ofb_reservoir_open(reservoir);
+    if (!res) {
+        perror("Error opening reservoir");
+        return -1;
+    }
+    if (ofb_reservoir_begin(res, length, iv) != 0) {
+        fprintf(stderr, "❌ Error: Reservoir has %llu bytes of keystream left, %llu needed.\n",
+                (unsigned long long) ofb_reservoir_remaining(res), (unsigned long long) length);
+        ofb_reservoir_close(res);
+        return -1;
+    }
+
+    FILE* fiv = fopen(iv_path, "wb");
+    int failed = !fiv || fwrite(iv, 1, 16, fiv) != 16;
+    if (fiv && fclose(fiv) != 0) {
+        failed = 1;
+    }
+    while (!failed && (n = fread(buffer, 1, sizeof(buffer), fin)) > 0) {
+        if (ofb_reservoir_update(res, buffer, buffer, n) != 0 || fwrite(buffer, 1, n, fout) != n) {
+            failed = 1;
+        }
+    }
+    ofb_reservoir_close(res);
+    return failed ? -1 : 0;
+}
+
+/*
+ * encrypt_append encrypts in_path onto the end of out_path, continuing the
+ * stream saved in state_path (or starting it when there is no state yet), and
+ * saves the new position. Only the appended bytes go through AES.
+ */
+static int encrypt_append(const char* state_path, const char* in_path, const char* out_path,
+                          const uint8_t* key, const uint8_t* iv) {
+    static uint8_t buffer[STREAM_BUFFER_SIZE];
+    ofb_state state;
+    ofb_ctx ctx;
+    uint64_t length = 0;
+    size_t n;
+
+    if (ofb_state_load(state_path, &state, &length, key, iv) == 0) {
+        ofb_resume(&ctx, key, &state);
+    } else if (errno == ENOENT) {
+        ofb_init(&ctx, key, iv);
+    } else {
+        perror("Error reading stream state");
+        return -1;
+    }
+
+    FILE* fin = fopen(in_path, "rb");
+    FILE* fout = fopen(out_path, "ab");
+    int failed = !fin || !fout || fseeko(fout, 0, SEEK_END) != 0;
+    if (failed) {
+        perror("Error opening files");
+    } else if ((uint64_t) ftello(fout) != length) {
+        // Data written without its state (or the wrong state file): appending
+        // would reuse keystream
+        fprintf(stderr, "❌ Error: %s is %lld bytes but its saved state covers %llu.\n",
+                out_path, (long long) ftello(fout), (unsigned long long) length);
+        failed = 1;
+    } else {
+        while ((n = fread(buffer, 1, sizeof(buffer), fin)) > 0) {
+            ofb_update(&ctx, buffer, buffer, n);
+            if (fwrite(buffer, 1, n, fout) != n) {
+                break;
+            }
+            length += n;
+        }
+        // The data must be on disk before the state that covers it
+        failed = ferror(fin) || ferror(fout) || fflush(fout) != 0 || fsync(fileno(fout)) != 0;
+    }
+    if (fin) fclose(fin);
+    if (fout && fclose(fout) != 0) failed = 1;
+
+    if (!failed) {
+        ofb_save(&ctx, &state);
+        if (ofb_state_save(state_path, &state, length, key, iv) != 0) {
+            perror("Error writing stream state");
+            failed = 1;
+        }
     }
+    ofb_final(&ctx, NULL);
+    return failed ? -1 : 0;
+}
+
+/*
+ * process_authenticated encrypts in_path into out_path and writes the CMAC
+ * of the IV and ciphertext to <out_path>.tag, or decrypts it and checks the
+ * tag in <in_path>.tag, in a single pass over the data. The tag is written
+ * only once the whole ciphertext has been; decrypted output goes to
+ * <out_path>.tmp and is renamed to out_path only after the tag matches.
+ */
+static int process_authenticated(const char* mac_key_path, const char* in_path, const char* out_path,
+                                 const uint8_t* key, const uint8_t* iv, int encrypt) {
+    static uint8_t buffer[STREAM_BUFFER_SIZE];
+    char tag_path[4096], tmp_path[4096];
+    uint8_t mac_key[16], tag[16];
+    ofb_cmac_ctx ctx;
+    size_t n;
 
-    fseek(fkey, 0, SEEK_END);
-    long key_size = ftell(fkey);
-    rewind(fkey);
+    snprintf(tag_path, sizeof(tag_path), "%s.tag", encrypt ? out_path : in_path);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", out_path);
+    if (read_block_file(mac_key_path, mac_key, "MAC key") != 0 ||
+        (!encrypt && read_block_file(tag_path, tag, "Tag") != 0)) {
+        return -1;
+    }
 
-    fseek(fiv, 0, SEEK_END);
-    long iv_size = ftell(fiv);
-    rewind(fiv);
+    const char* write_path = encrypt ? out_path : tmp_path;
+    FILE* fin = fopen(in_path, "rb");
+    FILE* fout = fopen(write_path, "wb");
+    int failed = !fin || !fout;
+    if (failed) {
+        perror("Error opening files");
+    } else {
+        ofb_cmac_init(&ctx, key, mac_key, iv);
+        while ((n = fread(buffer, 1, sizeof(buffer), fin)) > 0) {
+            if (encrypt) {
+                ofb_cmac_encrypt(&ctx, buffer, buffer, n);
+            } else {
+                ofb_cmac_decrypt(&ctx, buffer, buffer, n);
+            }
+            if (fwrite(buffer, 1, n, fout) != n) {
+                break;
+            }
+        }
+        failed = ferror(fin) || ferror(fout);
+    }
+    if (fout && fclose(fout) != 0) failed = 1;
+    if (fin) fclose(fin);
+
+    if (fin && fout) {
+        if (encrypt) {
+            // A tag only for a complete ciphertext
+            ofb_cmac_final(&ctx, tag);
+            FILE* ftag = failed ? NULL : fopen(tag_path, "wb");
+            if (!failed && (!ftag || fwrite(tag, 1, 16, ftag) != 16)) {
+                failed = 1;
+            }
+            if (ftag && fclose(ftag) != 0) {
+                failed = 1;
+            }
+        } else if (ofb_cmac_verify(&ctx, tag) != 0 && !failed) {
+            fprintf(stderr, "❌ Error: Authentication failed; %s does not match its tag.\n", in_path);
+            failed = 2;
+        } else if (!failed && rename(tmp_path, out_path) != 0) {
+            perror("Error renaming output");
+            failed = 1;
+        }
+    }
+    if (failed) {
+        remove(encrypt ? tag_path : tmp_path);  // no tag for a partial ciphertext
+    }
+    if (failed == 1) {
+        fprintf(stderr, "❌ Error: Failed to process %s.\n", in_path);
+    }
+    return failed ? -1 : 0;
+}
 
-    if (key_size != 16) {
-        fprintf(stderr, "❌ Error: Key must be exactly 16 bytes (got %ld bytes).\n", key_size);
-        fclose(fkey); fclose(fiv); fclose(fin); fclose(fout);
+/*
+ * process_ctr encrypts (or decrypts) in_path into out_path in CTR mode, by
+ * counter range on threads threads. With a range, only length bytes from
+ * offset are processed; the keystream starts right at offset.
+ */
+static int process_ctr(const char* in_path, const char* out_path, const uint8_t* key, const uint8_t* iv,
+                       uint64_t offset, uint64_t length, unsigned threads) {
+    struct stat st;
+    int in_fd = open(in_path, O_RDONLY);
+    int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int result = -1;
+
+    if (in_fd < 0 || out_fd < 0 || fstat(in_fd, &st) != 0) {
+        perror("Error opening files");
+    } else if (offset > (uint64_t) st.st_size) {
+        fprintf(stderr, "❌ Error: Offset is past the end of %s.\n", in_path);
+    } else {
+        if (length > (uint64_t) st.st_size - offset) {
+            length = (uint64_t) st.st_size - offset;
+        }
+        if (ctr_crypt_fd(in_fd, out_fd, key, iv, offset, length, threads) != 0) {
+            perror("Error processing");
+        } else {
+            result = 0;
+        }
+    }
+    if (in_fd >= 0) close(in_fd);
+    if (out_fd >= 0 && close(out_fd) != 0) result = -1;
+    return result;
+}
+
+/*
+ * process_xts encrypts (or decrypts) in_path into out_path in XTS mode, by
+ * sector range on threads threads. The input, and any range of it, must be
+ * whole sectors; the first sector of a range is offset / sector_size.
+ */
+static int process_xts(const char* in_path, const char* out_path, const uint8_t* key, const uint8_t* tweak_key,
+                       uint64_t sector_size, uint64_t offset, uint64_t length, unsigned threads, int decrypt) {
+    struct stat st;
+    xts_ctx ctx;
+
+    if (xts_init(&ctx, key, tweak_key, (size_t) sector_size) != 0) {
+        fprintf(stderr, "❌ Error: XTS needs a tweak key different from the data key.\n");
+        xts_final(&ctx);
+        return -1;
+    }
+
+    int in_fd = open(in_path, O_RDONLY);
+    int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int result = -1;
+
+    if (in_fd < 0 || out_fd < 0 || fstat(in_fd, &st) != 0) {
+        perror("Error opening files");
+    } else if (offset > (uint64_t) st.st_size) {
+        fprintf(stderr, "❌ Error: Offset is past the end of %s.\n", in_path);
+    } else {
+        if (length > (uint64_t) st.st_size - offset) {
+            length = (uint64_t) st.st_size - offset;
+        }
+        if (offset % sector_size != 0 || length % sector_size != 0) {
+            fprintf(stderr, "❌ Error: XTS needs whole %llu-byte sectors (offset %llu, length %llu).\n",
+                    (unsigned long long) sector_size, (unsigned long long) offset, (unsigned long long) length);
+        } else if (xts_crypt_fd(in_fd, out_fd, &ctx, offset, length, threads, decrypt) != 0) {
+            perror("Error processing");
+        } else {
+            result = 0;
+        }
+    }
+    xts_final(&ctx);
+    if (in_fd >= 0) close(in_fd);
+    if (out_fd >= 0 && close(out_fd) != 0) result = -1;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
         return 1;
     }
 
-    if (iv_size != 16) {
-        fprintf(stderr, "❌ Error: IV must be exactly 16 bytes (got %ld bytes).\n", iv_size);
-        fclose(fkey); fclose(fiv); fclose(fin); fclose(fout);
+    int encrypt = strcmp(argv[1], "-e") == 0;
+    int generate = strcmp(argv[1], "-g") == 0;
+    if (!encrypt && !generate && strcmp(argv[1], "-d") != 0) {
+        fprintf(stderr, "Invalid mode '%s'. Use -e to encrypt, -d to decrypt or -g to generate.\n", argv[1]);
         return 1;
     }
 
-    uint8_t key[16], iv[16];
-    size_t bytes_read_key = fread(key, 1, 16, fkey);
-    int extra_key_byte = fgetc(fkey);
-    if (bytes_read_key != 16 || extra_key_byte != EOF) {
-        fprintf(stderr, "❌ Error: Key file must contain exactly 16 bytes (no more, no less).\n");
-        fclose(fkey); fclose(fiv); fclose(fin); fclose(fout);
+    // Options may appear anywhere after the mode; the rest are positional
+    const char* files[4];
+    const char* reservoir = NULL;
+    const char* index_path = NULL;
+    const char* append_path = NULL;
+    const char* mac_path = NULL;
+    uint64_t interval = DEFAULT_INDEX_INTERVAL;
+    // All cores by default, capped to what --threads accepts
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = threads < 1 ? 1 : threads > MAX_THREADS ? MAX_THREADS : threads;
+    uint64_t offset = 0, length = UINT64_MAX, sector_size = DEFAULT_SECTOR_SIZE;
+    int nfiles = 0, pipeline = 0, ranged = 0, ctr = 0, xts = 0, sized = 0, masked_iv = 0;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--pipeline") == 0) {
+            pipeline = 1;
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            ctr = strcmp(argv[++i], "ctr") == 0;
+            xts = strcmp(argv[i], "xts") == 0;
+            if (!ctr && !xts && strcmp(argv[i], "ofb") != 0) {
+                fprintf(stderr, "❌ Error: Unknown mode '%s'. Use ofb, ctr or xts.\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sector-size") == 0 && i + 1 < argc) {
+            if (parse_size(argv[++i], &sector_size) != 0 || sector_size < XTS_MIN_SECTOR_SIZE ||
+                sector_size > XTS_MAX_SECTOR_SIZE || sector_size % 16 != 0) {
+                fprintf(stderr, "❌ Error: Sector size must be a multiple of 16 bytes from 16 to 16M.\n");
+                return 1;
+            }
+            sized = 1;
+        } else if (strcmp(argv[i], "--reservoir") == 0 && i + 1 < argc) {
+            reservoir = argv[++i];
+        } else if (strcmp(argv[i], "--reservoir-iv") == 0) {
+            masked_iv = 1;
+        } else if (strcmp(argv[i], "--index") == 0 && i + 1 < argc) {
+            index_path = argv[++i];
+        } else if (strcmp(argv[i], "--mac") == 0 && i + 1 < argc) {
+            mac_path = argv[++i];
+        } else if (strcmp(argv[i], "--append") == 0 && i + 1 < argc) {
+            append_path = argv[++i];
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            if (parse_size(argv[++i], &interval) != 0 || interval == 0 || interval % 16 != 0) {
+                fprintf(stderr, "❌ Error: Interval must be a positive multiple of 16 bytes.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (parse_threads(argv[++i], &threads) != 0) {
+                fprintf(stderr, "❌ Error: Invalid --threads '%s'; use a number from 1 to %d.\n",
+                        argv[i], MAX_THREADS);
+                return 1;
+            }
+        } else if ((strcmp(argv[i], "--offset") == 0 || strcmp(argv[i], "--length") == 0) && i + 1 < argc) {
+            if (parse_size(argv[i + 1], argv[i][2] == 'o' ? &offset : &length) != 0) {
+                fprintf(stderr, "❌ Error: Invalid %s '%s'.\n", argv[i], argv[i + 1]);
+                return 1;
+            }
+            ranged = 1;
+            ++i;
+        } else if (strncmp(argv[i], "--", 2) == 0 || nfiles == 4) {
+            usage(argv[0]);
+            return 1;
+        } else {
+            files[nfiles++] = argv[i];
+        }
+    }
+    if (nfiles != (reservoir ? 2 : 4) || (reservoir && (!encrypt || pipeline)) ||
+        (generate && pipeline) || (index_path && (generate || pipeline || reservoir)) ||
+        (ranged && (generate || pipeline || reservoir || (index_path && encrypt))) ||
+        (append_path && (!encrypt || pipeline || reservoir || index_path || ranged)) ||
+        (mac_path && (generate || pipeline || reservoir || index_path || ranged || append_path)) ||
+        ((ctr || xts) && (generate || pipeline || reservoir || index_path || append_path || mac_path)) ||
+        (sized && !xts) || (masked_iv && (encrypt || generate || ctr || xts))) {
+        usage(argv[0]);
         return 1;
     }
 
-    size_t bytes_read_iv = fread(iv, 1, 16, fiv);
-    int extra_iv_byte = fgetc(fiv);
-    if (bytes_read_iv != 16 || extra_iv_byte != EOF) {
-        fprintf(stderr, "❌ Error: IV file must contain exactly 16 bytes (no more, no less).\n");
-        fclose(fkey); fclose(fiv); fclose(fin); fclose(fout);
+    uint8_t key[16], iv[16];
+    if (!reservoir && (read_block_file(files[2], key, "Key") != 0 || read_block_file(files[3], iv, xts ? "Tweak key" : "IV") != 0)) {
         return 1;
     }
 
-    fclose(fkey);
-    fclose(fiv);
+    if (masked_iv) {
+        ofb_reservoir_iv(iv, iv, key);
+    }
+
+    if (generate) {
+        uint64_t size;
+        if (parse_size(files[1], &size) != 0) {
+            fprintf(stderr, "❌ Error: Invalid reservoir size '%s'.\n", files[1]);
+            return 1;
+        }
+        if (ofb_reservoir_create(files[0], key, iv, size) != 0) {
+            perror("Error creating reservoir");
+            return 1;
+        }
+        printf("Keystream reservoir created.\n");
+        return 0;
+    }
 
-    fseek(fin, 0, SEEK_END);
-    size_t file_size = (size_t) ftell(fin);
-    rewind(fin);
+    if (xts) {
+        if (process_xts(files[0], files[1], key, iv, sector_size, offset, length, (unsigned) threads, !encrypt) != 0) {
+            return 1;
+        }
+        printf("%s completed.\n", encrypt ? "Encryption" : "Decryption");
+        return 0;
+    }
 
-    uint8_t* input = malloc(file_size);
-    uint8_t* output = malloc(file_size);
-    if (!input || !output) {
-        fprintf(stderr, "❌ Error: Memory allocation failed.\n");
-        fclose(fin);
-        if (input) free(input);
-        if (output) free(output);
-        return 1;
+    if (ctr) {
+        if (process_ctr(files[0], files[1], key, iv, offset, length, (unsigned) threads) != 0) {
+            return 1;
+        }
+        printf("%s completed.\n", encrypt ? "Encryption" : "Decryption");
+        return 0;
     }
-    if (fread(input, 1, file_size, fin) != file_size) {
-        fprintf(stderr, "❌ Error: Failed to read input file completely.\n");
-        fclose(fin);
-        free(input);
-        free(output);
-        return 1;
+
+    if (ranged) {
+        if (process_range(index_path, files[0], files[1], key, iv, offset, length) != 0) {
+            return 1;
+        }
+        printf("%s completed.\n", encrypt ? "Encryption" : "Decryption");
+        return 0;
     }
-    fclose(fin);
 
-    uint8_t iv_copy[16];
-    memcpy(iv_copy, iv, 16);
-    OFBaes128e(output, input, file_size, iv_copy, key);
+    if (mac_path) {
+        if (process_authenticated(mac_path, files[0], files[1], key, iv, encrypt) != 0) {
+            return 1;
+        }
+        printf("%s completed.\n", encrypt ? "Encryption" : "Decryption");
+        return 0;
+    }
+
+    if (append_path) {
+        if (encrypt_append(append_path, files[0], files[1], key, iv) != 0) {
+            return 1;
+        }
+        printf("Encryption completed.\n");
+        return 0;
+    }
+
+    if (index_path && !encrypt) {
+        if (decrypt_indexed(index_path, files[0], files[1], key, iv, (unsigned) threads) != 0) {
+            return 1;
+        }
+        printf("Decryption completed.\n");
+        return 0;
+    }
+
+    FILE *fin = fopen(files[0], "rb");
+    FILE *fout = fopen(files[1], "wb");
+    if (!fin || !fout) {
+        perror("Error opening files");
+        if (fin) fclose(fin);
+        if (fout) fclose(fout);
+        return 1;
+    }
 
-    fwrite(output, 1, file_size, fout);
-    fclose(fout);
+    int failed = 0;
+    if (reservoir) {
+        char iv_path[4096];
+        snprintf(iv_path, sizeof(iv_path), "%s.iv", files[1]);
+        failed = encrypt_reservoir(reservoir, fin, fout, iv_path) != 0;
+    } else {
+        // Stream the file through a fixed-size buffer so any file size works
+        static uint8_t buffer[STREAM_BUFFER_SIZE];
+        ofb_ctx ctx;
+        ofb_pipe *pipe = NULL;
+        size_t n;
+        if (pipeline && !(pipe = ofb_pipe_start(key, iv))) {
+            fprintf(stderr, "Warning: could not start the keystream thread; continuing without it.\n");
+        }
+        if (!pipe) {
+            ofb_init(&ctx, key, iv);
+        }
+        ofb_index index;
+        uint64_t total = 0;
+        if (index_path) {
+            ofb_index_init(&index, interval);
+        }
+        while ((n = fread(buffer, 1, sizeof(buffer), fin)) > 0) {
+            if (pipe) {
+                ofb_pipe_update(pipe, buffer, buffer, n);
+            } else if (index_path) {
+                // Split the chunk at checkpoint boundaries and record the
+                // feedback register at each of them
+                for (size_t done = 0, step; done < n; done += step, total += step) {
+                    step = interval - total % interval;
+                    step = step < n - done ? step : n - done;
+                    ofb_update(&ctx, buffer + done, buffer + done, step);
+                    if ((total + step) % interval == 0 && ofb_index_add(&index, ctx.feedback) != 0) {
+                        failed = 1;
+                    }
+                }
+            } else {
+                ofb_update(&ctx, buffer, buffer, n);
+            }
+            if (fwrite(buffer, 1, n, fout) != n) {
+                break;
+            }
+        }
+        if (pipe) {
+            ofb_pipe_finish(pipe, NULL);
+        } else {
+            ofb_final(&ctx, NULL);
+        }
+        if (index_path) {
+            index.length = total;
+            if (!failed && ofb_index_save(index_path, &index, key, iv) != 0) {
+                perror("Error writing index");
+                failed = 1;
+            }
+            ofb_index_free(&index);
+        }
+    }
 
-    free(input);
-    free(output);
+    failed = failed || ferror(fin) || ferror(fout);
+    fclose(fin);
+    if (fclose(fout) != 0 || failed) {
+        fprintf(stderr, "❌ Error: Failed to process %s.\n", files[0]);
+        return 1;
+    }
 
     printf("%s completed.\n", encrypt ? "Encryption" : "Decryption");
     return 0;
-}
\ No newline at end of file
+}
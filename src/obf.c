@@ -2,6 +2,8 @@
 #include <string.h>
 #include "../include/aes128e.h"
 #include "../include/obf.h"
+#include "ofb_secret.h"
+#include "ofb_xor.h"
 
 /*
  * AES-128 OFB Mode Implementation
@@ -17,32 +19,211 @@
  * Date: 2025
  */
 
-void OFBaes128e(uint8_t *ciphertext, const uint8_t *plaintext, uint32_t length,
+// Keystream blocks generated ahead of each XOR in ofb_update (1 KiB)
+#define OFB_SPAN_BLOCKS 64
+
+void OFBaes128e(uint8_t *ciphertext, const uint8_t *plaintext, size_t length,
                 uint8_t *iv, const uint8_t *key)
 {
-    uint8_t block_out[16] = {0};
-    uint8_t feedback[16] = {0};
+    ofb_ctx ctx;
+
+    ofb_init(&ctx, key, iv);
+    ofb_update(&ctx, ciphertext, plaintext, length);
+    ofb_final(&ctx, iv);
+}
+
+void ofb_init(ofb_ctx *ctx, const uint8_t *key, const uint8_t *iv)
+{
+    // Expand the key once; every keystream block reuses the same schedule
+    aes128_init(&ctx->key, key);
+
+    // The IV is the first feedback value; no keystream bytes are available yet
+    memcpy(ctx->feedback, iv, 16);
+    ctx->used = 16;
+}
+
+void ofb_update(ofb_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len)
+{
+    // Use up the keystream left over from the previous call
+    while (len > 0 && ctx->used < 16) {
+        *out++ = *in++ ^ ctx->feedback[ctx->used++];
+        --len;
+    }
+
+    // Full blocks: run the chain for a span of blocks into a keystream buffer,
+    // then XOR the whole span with the vector kernel. Very long out-of-place
+    // output is written with non-temporal stores.
+    const int stream = ofb_xor_streaming(out, in, len);
+    const size_t span = len / 16 < OFB_SPAN_BLOCKS ? len / 16 : OFB_SPAN_BLOCKS;
+    _Alignas(64) uint8_t keystream[OFB_SPAN_BLOCKS * 16];
+    while (len >= 16) {
+        size_t blocks = len / 16 < OFB_SPAN_BLOCKS ? len / 16 : OFB_SPAN_BLOCKS;
+
+        for (size_t i = 0; i < blocks; ++i) {
+            aes128e_block(&ctx->key, ctx->feedback, ctx->feedback);
+            memcpy(keystream + 16 * i, ctx->feedback, 16);
+        }
 
-    // Copy IV into feedback buffer
-    memcpy(feedback, iv, 16);
+        if (stream) {
+            ofb_xor_stream(out, in, keystream, 16 * blocks);
+        } else {
+            ofb_xor(out, in, keystream, 16 * blocks);
+        }
+        out += 16 * blocks;
+        in += 16 * blocks;
+        len -= 16 * blocks;
+    }
+    ofb_wipe(keystream, 16 * span);
 
-    uint32_t full_blocks = length / 16;
-    uint32_t remaining = length % 16;
+    // Start a new keystream block for a trailing partial block
+    if (len > 0) {
+        aes128e_block(&ctx->key, ctx->feedback, ctx->feedback);
+        for (ctx->used = 0; ctx->used < len; ++ctx->used) {
+            out[ctx->used] = in[ctx->used] ^ ctx->feedback[ctx->used];
+        }
+    }
+}
 
-    // Encrypt each 16-byte block
-    for (uint32_t i = 0; i < full_blocks; ++i) {
-        aes128e(block_out, feedback, key);  // Generate keystream block
-        for (int j = 0; j < 16; ++j) {
-            ciphertext[i * 16 + j] = plaintext[i * 16 + j] ^ block_out[j];  // XOR with plaintext
+int ofb_update_iov(ofb_ctx *ctx, const struct iovec *in, const struct iovec *out, size_t n)
+{
+    size_t in_total = 0, out_total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        // Totals that wrap could compare equal and send the walk past the
+        // end of the shorter list
+        if (in[i].iov_len > SIZE_MAX - in_total || out[i].iov_len > SIZE_MAX - out_total) {
+            return -1;
         }
-        memcpy(feedback, block_out, 16);  // Update feedback with current keystream block
+        in_total += in[i].iov_len;
+        out_total += out[i].iov_len;
+    }
+    if (in_total != out_total) {
+        return -1;
+    }
+
+    // Walk both lists together, each step covering what is left of the
+    // current input and output fragments, whichever ends first
+    size_t a = 0, b = 0, in_off = 0, out_off = 0;
+    while (in_total > 0) {
+        if (in_off == in[a].iov_len) {
+            ++a;
+            in_off = 0;
+            continue;
+        }
+        if (out_off == out[b].iov_len) {
+            ++b;
+            out_off = 0;
+            continue;
+        }
+        size_t step = in[a].iov_len - in_off;
+        if (out[b].iov_len - out_off < step) {
+            step = out[b].iov_len - out_off;
+        }
+        ofb_update(ctx, (uint8_t *) out[b].iov_base + out_off,
+                   (const uint8_t *) in[a].iov_base + in_off, step);
+        in_off += step;
+        out_off += step;
+        in_total -= step;
+    }
+    return 0;
+}
+
+void ofb_skip(ofb_ctx *ctx, uint64_t len)
+{
+    uint64_t leftover = 16 - ctx->used;
+
+    if (len <= leftover) {
+        ctx->used += (unsigned) len;
+        return;
+    }
+    len -= leftover;
+
+    // Whole blocks, then the part of the next block that is skipped
+    for (uint64_t blocks = (len - 1) / 16 + 1; blocks > 0; --blocks) {
+        aes128e_block(&ctx->key, ctx->feedback, ctx->feedback);
+    }
+    ctx->used = (unsigned) ((len - 1) % 16 + 1);
+}
+
+void ofb_save(const ofb_ctx *ctx, ofb_state *state)
+{
+    memcpy(state->feedback, ctx->feedback, 16);
+    state->used = ctx->used;
+}
+
+int ofb_resume(ofb_ctx *ctx, const uint8_t *key, const ofb_state *state)
+{
+    if (state->used > 16) {
+        return -1;
     }
+    ofb_init(ctx, key, state->feedback);
+    ctx->used = state->used;
+    return 0;
+}
+
+void ofb_update_multi(ofb_ctx *const *ctxs, uint8_t *const *out, const uint8_t *const *in,
+                      const size_t *len, size_t n)
+{
+    for (size_t base = 0; base < n; base += OFB_LANES) {
+        const size_t group = n - base < OFB_LANES ? n - base : OFB_LANES;
+        const aes128_ctx *keys[OFB_LANES];
+        uint8_t feedback[OFB_LANES * 16];
+        size_t stream[OFB_LANES], done[OFB_LANES];
+        size_t active = 0;
+
+        // Use up leftover keystream so every lane starts on a block boundary;
+        // lanes with less than a block to go never join the lockstep loop
+        for (size_t i = base; i < base + group; ++i) {
+            size_t head = 16 - ctxs[i]->used;
+            if (head > len[i]) {
+                head = len[i];
+            }
+            ofb_update(ctxs[i], out[i], in[i], head);
 
-    // Handle final partial block if it exists
-    if (remaining > 0) {
-        aes128e(block_out, feedback, key);  // Generate next keystream block
-        for (uint32_t j = 0; j < remaining; ++j) {
-            ciphertext[full_blocks * 16 + j] = plaintext[full_blocks * 16 + j] ^ block_out[j];
+            if (len[i] - head < 16) {
+                ofb_update(ctxs[i], out[i] + head, in[i] + head, len[i] - head);
+                continue;
+            }
+            keys[active] = &ctxs[i]->key;
+            memcpy(feedback + 16 * active, ctxs[i]->feedback, 16);
+            stream[active] = i;
+            done[active] = head;
+            ++active;
         }
+
+        while (active > 0) {
+            // One keystream block for every active lane
+            aes128e_multikey(keys, feedback, feedback, active);
+
+            for (size_t a = 0; a < active; ) {
+                const size_t i = stream[a];
+                ofb_xor_block(out[i] + done[a], in[i] + done[a], feedback + 16 * a);
+                done[a] += 16;
+                if (len[i] - done[a] >= 16) {
+                    ++a;
+                    continue;
+                }
+
+                // Lane finished its full blocks: hand the tail to ofb_update
+                // and move the last active lane into this slot
+                memcpy(ctxs[i]->feedback, feedback + 16 * a, 16);
+                ofb_update(ctxs[i], out[i] + done[a], in[i] + done[a], len[i] - done[a]);
+                --active;
+                keys[a] = keys[active];
+                memcpy(feedback + 16 * a, feedback + 16 * active, 16);
+                stream[a] = stream[active];
+                done[a] = done[active];
+            }
+        }
+        ofb_wipe(feedback, sizeof(feedback));
+    }
+}
+
+void ofb_final(ofb_ctx *ctx, uint8_t *iv)
+{
+    if (iv) {
+        memcpy(iv, ctx->feedback, 16);
     }
+
+    // Do not leave the key schedule or keystream behind in caller memory
+    ofb_wipe(ctx, sizeof(*ctx));
 }
@@ -0,0 +1,183 @@
+#include <string.h>
+#include "../include/aes128e.h"
+#include "../include/obf.h"
+#include "../include/ofb_cmac.h"
+#include "ofb_secret.h"
+#include "ofb_xor.h"
+
+/*
+ * AES-128 CMAC and Authenticated OFB
+ * ----------------------------------
+ * CMAC (SP 800-38B): x = E_K(x ^ M_i) for every block but the last, which
+ * is XORed with subkey K1 if it is complete, or padded with 10...0 and XORed
+ * with K2 otherwise, before the final encryption gives the tag.
+ *
+ * The tag of the combined stream is CMAC(K_mac, IV || C), so that a changed
+ * IV, which changes the whole plaintext, is detected too. The IV is the
+ * first CMAC block, held back like any other. From then on the held-back
+ * CMAC block and the OFB keystream block stay in step: after T bytes both
+ * hold T % 16 bytes, or a full block at a block boundary (T = 0 included).
+ * So a single step, taken whenever the keystream block is used up, absorbs
+ * the held-back block and generates the next keystream block, as two lanes
+ * of one multi-key AES call.
+ */
+
+// Doubling in GF(2^128) for the subkeys: shift left, reduce by x^128 + x^7 + x^2 + x + 1
+static void dbl(uint8_t *out, const uint8_t *in)
+{
+    const uint8_t carry = in[0] >> 7;
+
+    for (int i = 0; i < 15; ++i) {
+        out[i] = (uint8_t) (in[i] << 1 | in[i + 1] >> 7);
+    }
+    out[15] = (uint8_t) (in[15] << 1 ^ (carry ? 0x87 : 0));
+}
+
+void aes128_cmac_init(aes128_cmac_ctx *ctx, const uint8_t *key)
+{
+    uint8_t l[16] = {0};
+
+    aes128_init(&ctx->key, key);
+    aes128e_block(&ctx->key, l, l);
+    dbl(ctx->k1, l);
+    dbl(ctx->k2, ctx->k1);
+    memset(ctx->x, 0, 16);
+    ctx->pending_len = 0;
+    ofb_wipe(l, sizeof(l));
+}
+
+// x = E_K(x ^ pending) for a full pending block that is known not to be the last
+static void absorb(aes128_cmac_ctx *ctx)
+{
+    ofb_xor_block(ctx->x, ctx->x, ctx->pending);
+    aes128e_block(&ctx->key, ctx->x, ctx->x);
+    ctx->pending_len = 0;
+}
+
+void aes128_cmac_update(aes128_cmac_ctx *ctx, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        if (ctx->pending_len == 16) {
+            absorb(ctx);
+        }
+        size_t n = 16 - ctx->pending_len < len ? 16 - ctx->pending_len : len;
+        memcpy(ctx->pending + ctx->pending_len, data, n);
+        ctx->pending_len += (unsigned) n;
+        data += n;
+        len -= n;
+    }
+}
+
+void aes128_cmac_final(aes128_cmac_ctx *ctx, uint8_t *tag)
+{
+    if (ctx->pending_len == 16) {
+        ofb_xor_block(ctx->x, ctx->x, ctx->k1);
+    } else {
+        ctx->pending[ctx->pending_len] = 0x80;
+        memset(ctx->pending + ctx->pending_len + 1, 0, 15 - ctx->pending_len);
+        ofb_xor_block(ctx->x, ctx->x, ctx->k2);
+    }
+    ofb_xor_block(ctx->x, ctx->x, ctx->pending);
+    aes128e_block(&ctx->key, tag, ctx->x);
+    ofb_wipe(ctx, sizeof(*ctx));
+}
+
+void aes128_cmac(uint8_t *tag, const uint8_t *msg, size_t len, const uint8_t *key)
+{
+    aes128_cmac_ctx ctx;
+
+    aes128_cmac_init(&ctx, key);
+    aes128_cmac_update(&ctx, msg, len);
+    aes128_cmac_final(&ctx, tag);
+}
+
+void ofb_cmac_init(ofb_cmac_ctx *ctx, const uint8_t *key, const uint8_t *mac_key, const uint8_t *iv)
+{
+    ofb_init(&ctx->ofb, key, iv);
+    aes128_cmac_init(&ctx->mac, mac_key);
+    aes128_cmac_update(&ctx->mac, iv, 16);
+}
+
+/*
+ * step starts the next keystream block and absorbs the held-back CMAC block
+ * (the IV, or the previous ciphertext block), both in one call.
+ */
+static void step(ofb_cmac_ctx *ctx)
+{
+    const aes128_ctx *keys[2] = { &ctx->ofb.key, &ctx->mac.key };
+    _Alignas(16) uint8_t lanes[32];
+    const size_t n = ctx->mac.pending_len == 16 ? 2 : 1;
+
+    memcpy(lanes, ctx->ofb.feedback, 16);
+    if (n == 2) {
+        ofb_xor_block(lanes + 16, ctx->mac.x, ctx->mac.pending);
+    }
+    aes128e_multikey(keys, lanes, lanes, n);
+    memcpy(ctx->ofb.feedback, lanes, 16);
+    if (n == 2) {
+        memcpy(ctx->mac.x, lanes + 16, 16);
+    }
+    ctx->ofb.used = 0;
+    ctx->mac.pending_len = 0;
+}
+
+static void update(ofb_cmac_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len, int decrypt)
+{
+    while (len > 0) {
+        if (ctx->ofb.used == 16) {
+            step(ctx);
+        }
+        const unsigned used = ctx->ofb.used;
+        size_t n = 16 - used < len ? 16 - used : len;
+
+        // The MAC covers the ciphertext: the input when decrypting (taken
+        // before an in-place XOR overwrites it), the output when encrypting
+        if (decrypt) {
+            memcpy(ctx->mac.pending + used, in, n);
+        }
+        if (n == 16) {
+            ofb_xor_block(out, in, ctx->ofb.feedback);
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = in[i] ^ ctx->ofb.feedback[used + i];
+            }
+        }
+        if (!decrypt) {
+            memcpy(ctx->mac.pending + used, out, n);
+        }
+
+        ctx->ofb.used += (unsigned) n;
+        ctx->mac.pending_len += (unsigned) n;
+        out += n;
+        in += n;
+        len -= n;
+    }
+}
+
+void ofb_cmac_encrypt(ofb_cmac_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len)
+{
+    update(ctx, out, in, len, 0);
+}
+
+void ofb_cmac_decrypt(ofb_cmac_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len)
+{
+    update(ctx, out, in, len, 1);
+}
+
+void ofb_cmac_final(ofb_cmac_ctx *ctx, uint8_t *tag)
+{
+    ofb_final(&ctx->ofb, NULL);
+    aes128_cmac_final(&ctx->mac, tag);
+}
+
+int ofb_cmac_verify(ofb_cmac_ctx *ctx, const uint8_t *tag)
+{
+    uint8_t computed[16], diff = 0;
+
+    ofb_cmac_final(ctx, computed);
+    for (int i = 0; i < 16; ++i) {
+        diff |= computed[i] ^ tag[i];
+    }
+    ofb_wipe(computed, sizeof(computed));
+    return diff ? -1 : 0;
+}
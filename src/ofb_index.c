@@ -0,0 +1,243 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/aes128e.h"
+#include "../include/aes128d.h"
+#include "../include/obf.h"
+#include "../include/ofb_index.h"
+#include "ofb_secret.h"
+#include "workers.h"
+
+/*
+ * AES-128 OFB Checkpoint Index
+ * ----------------------------
+ * File layout (integers in host byte order):
+ *
+ *   magic "OFBIDX1\0", interval, length, count (8 bytes each)
+ *   E_m(IV)                      verifies key and IV on load
+ *   E_m(checkpoint 1..count)     16 bytes each
+ *
+ * m is the masking key E_K(MASK_LABEL) set up by ofb_mask_init() and
+ * ofb_unmask_init().
+ */
+
+#define INDEX_MAGIC "OFBIDX1"
+#define INDEX_BUFFER_SIZE (64 * 1024)
+
+static const uint8_t MASK_LABEL[16] = "OFB checkpoints";
+
+int ofb_index_init(ofb_index *index, uint64_t interval)
+{
+    memset(index, 0, sizeof(*index));
+    if (interval == 0 || interval % 16 != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    index->interval = interval;
+    return 0;
+}
+
+int ofb_index_add(ofb_index *index, const uint8_t *feedback)
+{
+    // Grow by doubling; the index is small next to the data it covers
+    if ((index->count & (index->count - 1)) == 0) {
+        size_t capacity = index->count ? 2 * index->count : 1;
+        uint8_t *grown = realloc(index->checkpoints, 16 * capacity);
+        if (!grown) {
+            return -1;
+        }
+        index->checkpoints = grown;
+    }
+    memcpy(index->checkpoints + 16 * index->count++, feedback, 16);
+    return 0;
+}
+
+int ofb_index_save(const char *path, const ofb_index *index, const uint8_t *key, const uint8_t *iv)
+{
+    const uint64_t fields[3] = { index->interval, index->length, index->count };
+    uint8_t block[16];
+    aes128_ctx ctx;
+
+    if (index->count != index->length / index->interval) {
+        errno = EINVAL;
+        return -1;
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return -1;
+    }
+
+    ofb_mask_init(&ctx, MASK_LABEL, key);
+    aes128e_block(&ctx, block, iv);
+
+    int failed = fwrite(INDEX_MAGIC, 1, 8, f) != 8 || fwrite(fields, sizeof(fields), 1, f) != 1 ||
+                 fwrite(block, 1, 16, f) != 16;
+    for (size_t i = 0; i < index->count && !failed; ++i) {
+        aes128e_block(&ctx, block, index->checkpoints + 16 * i);
+        failed = fwrite(block, 1, 16, f) != 16;
+    }
+    ofb_wipe(&ctx, sizeof(ctx));
+    if (fclose(f) != 0) {
+        failed = 1;
+    }
+    return failed ? -1 : 0;
+}
+
+int ofb_index_load(const char *path, ofb_index *index, const uint8_t *key, const uint8_t *iv)
+{
+    char magic[8];
+    uint64_t fields[3];
+    uint8_t block[16];
+    aes128d_ctx ctx;
+
+    memset(index, 0, sizeof(*index));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return -1;
+    }
+
+    if (fread(magic, 1, 8, f) != 8 || memcmp(magic, INDEX_MAGIC, 8) != 0 ||
+        fread(fields, sizeof(fields), 1, f) != 1 || fread(block, 1, 16, f) != 16 ||
+        fields[0] == 0 || fields[0] % 16 != 0 || fields[2] > SIZE_MAX / 16 ||
+        fields[2] != fields[1] / fields[0]) {
+        goto invalid;
+    }
+
+    ofb_unmask_init(&ctx, MASK_LABEL, key);
+    aes128d_block(&ctx, block, block);
+    if (memcmp(block, iv, 16) != 0) {
+        goto invalid;
+    }
+
+    index->interval = fields[0];
+    index->length = fields[1];
+    index->count = (size_t) fields[2];
+    index->checkpoints = malloc(16 * index->count + 1);
+    if (!index->checkpoints) {
+        ofb_wipe(&ctx, sizeof(ctx));
+        fclose(f);
+        errno = ENOMEM;
+        return -1;
+    }
+    if (fread(index->checkpoints, 16, index->count, f) != index->count) {
+        ofb_index_free(index);
+        goto invalid;
+    }
+    aes128d_blocks(&ctx, index->checkpoints, index->checkpoints, index->count);
+    ofb_wipe(&ctx, sizeof(ctx));
+    fclose(f);
+    return 0;
+
+invalid:
+    ofb_wipe(&ctx, sizeof(ctx));
+    fclose(f);
+    errno = EINVAL;
+    return -1;
+}
+
+void ofb_index_free(ofb_index *index)
+{
+    free(index->checkpoints);
+    index->checkpoints = NULL;
+    index->count = 0;
+}
+
+/*
+ * Parallel decryption: segment s covers bytes [s * interval, (s + 1) * interval)
+ * and starts from the IV (s = 0) or checkpoint s.
+ */
+typedef struct {
+    int in_fd, out_fd;
+    const ofb_index *index;
+    const uint8_t *key, *iv;
+} decrypt_job;
+
+static int decrypt_segment(void *arg, uint64_t segment, uint8_t *buffer)
+{
+    const decrypt_job *job = arg;
+    const ofb_index *index = job->index;
+    uint64_t offset = segment * index->interval;
+    uint64_t end = offset + index->interval < index->length ? offset + index->interval : index->length;
+    ofb_ctx ctx;
+
+    ofb_init(&ctx, job->key, segment ? index->checkpoints + 16 * (segment - 1) : job->iv);
+    while (offset < end) {
+        size_t n = end - offset < INDEX_BUFFER_SIZE ? (size_t) (end - offset) : INDEX_BUFFER_SIZE;
+        if (pread(job->in_fd, buffer, n, (off_t) offset) != (ssize_t) n) {
+            ofb_final(&ctx, NULL);
+            return -1;
+        }
+        ofb_update(&ctx, buffer, buffer, n);
+        if (pwrite(job->out_fd, buffer, n, (off_t) offset) != (ssize_t) n) {
+            ofb_final(&ctx, NULL);
+            return -1;
+        }
+        offset += n;
+    }
+    ofb_final(&ctx, NULL);
+    return 0;
+}
+
+int ofb_index_decrypt(int in_fd, int out_fd, const ofb_index *index,
+                      const uint8_t *key, const uint8_t *iv, unsigned threads)
+{
+    struct stat st;
+    decrypt_job job = { .in_fd = in_fd, .out_fd = out_fd, .index = index, .key = key, .iv = iv };
+
+    if (fstat(in_fd, &st) != 0) {
+        return -1;
+    }
+    if ((uint64_t) st.st_size != index->length) {
+        errno = EINVAL;
+        return -1;
+    }
+    return run_segments(decrypt_segment, &job, (index->length + index->interval - 1) / index->interval,
+                        INDEX_BUFFER_SIZE, threads);
+}
+
+void ofb_reader_init(ofb_reader *reader, const uint8_t *key, const uint8_t *iv, const ofb_index *index)
+{
+    ofb_init(&reader->stream, key, iv);
+    reader->index = index;
+    memcpy(reader->iv, iv, 16);
+    reader->offset = 0;
+}
+
+void ofb_seek(ofb_reader *reader, uint64_t offset)
+{
+    const ofb_index *index = reader->index;
+    uint64_t segment = 0, start = 0;
+
+    if (index) {
+        segment = offset / index->interval;
+        if (segment > index->count) {
+            segment = index->count;
+        }
+        start = segment * index->interval;
+    }
+
+    // Restart from the checkpoint unless the current position is already
+    // between it and the target
+    if (reader->offset < start || reader->offset > offset) {
+        memcpy(reader->stream.feedback, segment ? index->checkpoints + 16 * (segment - 1) : reader->iv, 16);
+        reader->stream.used = 16;
+        reader->offset = start;
+    }
+    ofb_skip(&reader->stream, offset - reader->offset);
+    reader->offset = offset;
+}
+
+void ofb_read(ofb_reader *reader, uint8_t *out, const uint8_t *in, size_t len)
+{
+    ofb_update(&reader->stream, out, in, len);
+    reader->offset += len;
+}
+
+void ofb_reader_final(ofb_reader *reader)
+{
+    ofb_final(&reader->stream, NULL);
+    memset(reader->iv, 0, 16);
+}
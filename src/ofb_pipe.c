@@ -0,0 +1,250 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/aes128e.h"
+#include "../include/ofb_pipe.h"
+#include "ofb_secret.h"
+#include "ofb_xor.h"
+
+/*
+ * Pipelined AES-128 OFB
+ * ---------------------
+ * The producer thread runs the OFB feedback chain and writes keystream blocks
+ * into ring[] in batches of OFB_PIPE_BATCH; the consumer (the caller of
+ * ofb_pipe_update) XORs them into the data. head and tail count blocks ever
+ * produced and consumed. Each is written by one side only, published with a
+ * release store and read by the other side with an acquire load, so no lock is
+ * needed. They live on separate cache lines so the two cores do not contend.
+ *
+ * A side that finds the ring full (or empty) spins and yields for a bounded
+ * number of polls, since the other side normally catches up within a batch,
+ * and then sleeps on a condition variable. Before sleeping it raises its
+ * waiting flag; after publishing a position the other side checks that flag
+ * and only then takes the mutex to signal, so the lock stays off the path
+ * where both keep up.
+ * The flag store and the position store are each followed by a seq_cst
+ * fence, so either the sleeper sees the new position when it checks again
+ * under the mutex or the publisher sees the flag: no wakeup is lost.
+ */
+
+// A batch is never split by the end of the ring
+_Static_assert(OFB_PIPE_BLOCKS % OFB_PIPE_BATCH == 0, "ring must hold whole batches");
+
+/*
+ * A waiting side polls the other's position OFB_PIPE_SPINS times with a CPU
+ * pause, then OFB_PIPE_YIELDS times giving up its core (which lets the other
+ * side run when both share one), before it goes to sleep.
+ */
+#define OFB_PIPE_SPINS  64
+#define OFB_PIPE_YIELDS 16
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#else
+#define cpu_relax() ((void) 0)
+#endif
+
+struct ofb_pipe {
+    _Alignas(64) _Atomic size_t head;   // blocks produced (written by the producer)
+    _Alignas(64) _Atomic size_t tail;   // blocks consumed (written by the consumer)
+    _Atomic bool stop;
+    pthread_t thread;
+
+    // Sleeping when the ring stays full (producer) or empty (consumer)
+    _Atomic bool producer_waiting, consumer_waiting;
+    pthread_mutex_t lock;
+    pthread_cond_t not_full, not_empty;
+
+    // Producer state
+    aes128_ctx key;
+    uint8_t feedback[16];
+
+    // Consumer state: the current keystream block and the bytes of it used
+    uint8_t current[16];
+    unsigned used;
+
+    _Alignas(64) uint8_t ring[OFB_PIPE_BLOCKS][16];
+};
+
+// The producer may go on once a batch fits, or must stop
+static bool has_space(ofb_pipe *pipe, size_t head)
+{
+    size_t tail = atomic_load_explicit(&pipe->tail, memory_order_acquire);
+    return OFB_PIPE_BLOCKS - (head - tail) >= OFB_PIPE_BATCH ||
+           atomic_load_explicit(&pipe->stop, memory_order_relaxed);
+}
+
+static bool has_blocks(ofb_pipe *pipe, size_t tail)
+{
+    return atomic_load_explicit(&pipe->head, memory_order_acquire) != tail;
+}
+
+/*
+ * wait_until returns once ready(pipe, pos) holds: after a bounded number of
+ * polls, or asleep on cond with *waiting raised until the other side
+ * signals it.
+ */
+static void wait_until(ofb_pipe *pipe, bool (*ready)(ofb_pipe *, size_t), size_t pos,
+                       _Atomic bool *waiting, pthread_cond_t *cond)
+{
+    for (int i = 0; i < OFB_PIPE_SPINS + OFB_PIPE_YIELDS; ++i) {
+        if (ready(pipe, pos)) {
+            return;
+        }
+        if (i < OFB_PIPE_SPINS) {
+            cpu_relax();
+        } else {
+            sched_yield();
+        }
+    }
+
+    pthread_mutex_lock(&pipe->lock);
+    atomic_store_explicit(waiting, true, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (!ready(pipe, pos)) {
+        pthread_cond_wait(cond, &pipe->lock);
+    }
+    atomic_store_explicit(waiting, false, memory_order_relaxed);
+    pthread_mutex_unlock(&pipe->lock);
+}
+
+// Called after publishing a position: wakes the other side if it sleeps
+static void wake(ofb_pipe *pipe, _Atomic bool *waiting, pthread_cond_t *cond)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(waiting, memory_order_relaxed)) {
+        pthread_mutex_lock(&pipe->lock);
+        pthread_cond_signal(cond);
+        pthread_mutex_unlock(&pipe->lock);
+    }
+}
+
+static void *producer(void *arg)
+{
+    ofb_pipe *pipe = arg;
+    size_t head = atomic_load_explicit(&pipe->head, memory_order_relaxed);
+
+    for (;;) {
+        // Ring full: wait for the consumer
+        wait_until(pipe, has_space, head, &pipe->producer_waiting, &pipe->not_full);
+        if (atomic_load_explicit(&pipe->stop, memory_order_relaxed)) {
+            break;
+        }
+
+        uint8_t (*slot)[16] = &pipe->ring[head % OFB_PIPE_BLOCKS];
+        for (size_t i = 0; i < OFB_PIPE_BATCH; ++i) {
+            aes128e_block(&pipe->key, pipe->feedback, pipe->feedback);
+            memcpy(slot[i], pipe->feedback, 16);
+        }
+        head += OFB_PIPE_BATCH;
+        atomic_store_explicit(&pipe->head, head, memory_order_release);
+        wake(pipe, &pipe->consumer_waiting, &pipe->not_empty);
+    }
+    return NULL;
+}
+
+/*
+ * wait_blocks returns how many produced blocks the consumer can read
+ * contiguously from tail, waiting until there is at least one.
+ */
+static size_t wait_blocks(ofb_pipe *pipe, size_t tail)
+{
+    // Ring empty: wait for the producer
+    wait_until(pipe, has_blocks, tail, &pipe->consumer_waiting, &pipe->not_empty);
+
+    size_t head = atomic_load_explicit(&pipe->head, memory_order_acquire);
+    size_t contiguous = OFB_PIPE_BLOCKS - tail % OFB_PIPE_BLOCKS;
+    return head - tail < contiguous ? head - tail : contiguous;
+}
+
+ofb_pipe *ofb_pipe_start(const uint8_t *key, const uint8_t *iv)
+{
+    ofb_pipe *pipe = aligned_alloc(_Alignof(ofb_pipe), sizeof(ofb_pipe));
+    if (!pipe) {
+        return NULL;
+    }
+
+    atomic_init(&pipe->head, 0);
+    atomic_init(&pipe->tail, 0);
+    atomic_init(&pipe->stop, false);
+    atomic_init(&pipe->producer_waiting, false);
+    atomic_init(&pipe->consumer_waiting, false);
+    pthread_mutex_init(&pipe->lock, NULL);
+    pthread_cond_init(&pipe->not_full, NULL);
+    pthread_cond_init(&pipe->not_empty, NULL);
+    aes128_init(&pipe->key, key);
+    memcpy(pipe->feedback, iv, 16);
+    memcpy(pipe->current, iv, 16);
+    pipe->used = 16;
+
+    if (pthread_create(&pipe->thread, NULL, producer, pipe) != 0) {
+        pthread_cond_destroy(&pipe->not_empty);
+        pthread_cond_destroy(&pipe->not_full);
+        pthread_mutex_destroy(&pipe->lock);
+        free(pipe);
+        return NULL;
+    }
+    return pipe;
+}
+
+void ofb_pipe_update(ofb_pipe *pipe, uint8_t *out, const uint8_t *in, size_t len)
+{
+    size_t tail = atomic_load_explicit(&pipe->tail, memory_order_relaxed);
+
+    // Use up the keystream left over from the previous call
+    while (len > 0 && pipe->used < 16) {
+        *out++ = *in++ ^ pipe->current[pipe->used++];
+        --len;
+    }
+
+    // XOR whole blocks straight out of the ring
+    while (len >= 16) {
+        size_t n = wait_blocks(pipe, tail);
+        if (n > len / 16) {
+            n = len / 16;
+        }
+
+        const uint8_t *keystream = pipe->ring[tail % OFB_PIPE_BLOCKS];
+        ofb_xor(out, in, keystream, 16 * n);
+        memcpy(pipe->current, keystream + 16 * (n - 1), 16);
+
+        tail += n;
+        atomic_store_explicit(&pipe->tail, tail, memory_order_release);
+        wake(pipe, &pipe->producer_waiting, &pipe->not_full);
+        out += 16 * n;
+        in += 16 * n;
+        len -= 16 * n;
+    }
+
+    // Take one more block for a trailing partial block
+    if (len > 0) {
+        wait_blocks(pipe, tail);
+        memcpy(pipe->current, pipe->ring[tail % OFB_PIPE_BLOCKS], 16);
+        atomic_store_explicit(&pipe->tail, tail + 1, memory_order_release);
+        wake(pipe, &pipe->producer_waiting, &pipe->not_full);
+        for (pipe->used = 0; pipe->used < len; ++pipe->used) {
+            out[pipe->used] = in[pipe->used] ^ pipe->current[pipe->used];
+        }
+    }
+}
+
+void ofb_pipe_finish(ofb_pipe *pipe, uint8_t *iv)
+{
+    atomic_store_explicit(&pipe->stop, true, memory_order_relaxed);
+    wake(pipe, &pipe->producer_waiting, &pipe->not_full);
+    pthread_join(pipe->thread, NULL);
+    pthread_cond_destroy(&pipe->not_empty);
+    pthread_cond_destroy(&pipe->not_full);
+    pthread_mutex_destroy(&pipe->lock);
+
+    if (iv) {
+        memcpy(iv, pipe->current, 16);
+    }
+
+    // Do not leave the key schedule or unused keystream in freed memory
+    ofb_wipe(pipe, sizeof(*pipe));
+    free(pipe);
+}
@@ -0,0 +1,242 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/aes128e.h"
+#include "../include/aes128d.h"
+#include "../include/ofb_reservoir.h"
+#include "ofb_secret.h"
+#include "ofb_xor.h"
+
+/*
+ * AES-128 OFB Keystream Reservoir
+ * -------------------------------
+ * File layout (integers in host byte order):
+ *
+ *   0     header (reservoir_header)
+ *   4096  keystream blocks 0 .. blocks-1, block i being the i-th OFB output
+ *
+ * consumed counts the blocks handed out so far. next_iv is the feedback value
+ * that precedes block consumed (the original IV while nothing is used), which
+ * is the IV a receiver needs. It is kept in the header because the block it
+ * comes from is wiped once used. Keystream starts on a page boundary so the
+ * whole file can be mapped and XORed in place.
+ *
+ * next_iv is the last keystream block of the previous message, so it is never
+ * published as is: XORed with that message's last ciphertext block it would
+ * give the plaintext. Messages report E_m(next_iv) instead, where the masking
+ * key m = E_K(MASK_LABEL) is stored in the header (which is secret anyway)
+ * because the key is not at hand when keystream is handed out.
+ */
+
+#define RESERVOIR_MAGIC "OFBRSV2"
+#define DATA_OFFSET 4096
+
+static const uint8_t MASK_LABEL[16] = "OFB reservoir";
+
+typedef struct {
+    char magic[8];
+    uint64_t blocks;
+    uint64_t consumed;
+    uint8_t next_iv[16];
+    uint8_t mask[16];
+} reservoir_header;
+
+struct ofb_reservoir {
+    int fd;
+    uint8_t *map;
+    size_t map_len;
+    uint64_t next;  // next reserved block this handle will use
+    uint64_t end;   // end of this handle's reservation
+    int ended;      // a call took part of a block, so the message is over
+};
+
+static reservoir_header *header(const ofb_reservoir *res)
+{
+    return (reservoir_header *) res->map;
+}
+
+static uint8_t *block(const ofb_reservoir *res, uint64_t index)
+{
+    return res->map + DATA_OFFSET + 16 * index;
+}
+
+int ofb_reservoir_create(const char *path, const uint8_t *key, const uint8_t *iv, uint64_t bytes)
+{
+    const uint64_t blocks = bytes / 16 + (bytes % 16 != 0);
+    const size_t map_len = DATA_OFFSET + 16 * blocks;
+    aes128_ctx ctx;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, (off_t) map_len) != 0) {
+        close(fd);
+        return -1;
+    }
+    uint8_t *map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    // The OFB chain: block i is the encryption of block i - 1
+    aes128_init(&ctx, key);
+    const uint8_t *feedback = iv;
+    for (uint64_t i = 0; i < blocks; ++i) {
+        uint8_t *out = map + DATA_OFFSET + 16 * i;
+        aes128e_block(&ctx, out, feedback);
+        feedback = out;
+    }
+    ofb_wipe(&ctx, sizeof(ctx));
+
+    // Write the header last, so a reservoir cut short is never valid
+    reservoir_header *hdr = (reservoir_header *) map;
+    hdr->blocks = blocks;
+    hdr->consumed = 0;
+    memcpy(hdr->next_iv, iv, 16);
+    ofb_mask_key(hdr->mask, MASK_LABEL, key);
+    memcpy(hdr->magic, RESERVOIR_MAGIC, sizeof(hdr->magic));
+
+    int result = msync(map, map_len, MS_SYNC);
+    munmap(map, map_len);
+    if (close(fd) != 0) {
+        result = -1;
+    }
+    return result;
+}
+
+ofb_reservoir *ofb_reservoir_open(const char *path)
+{
+    struct stat st;
+    ofb_reservoir *res = calloc(1, sizeof(*res));
+    if (!res) {
+        return NULL;
+    }
+
+    res->fd = open(path, O_RDWR);
+    if (res->fd < 0 || fstat(res->fd, &st) != 0) {
+        goto fail;
+    }
+    if (st.st_size < DATA_OFFSET || (st.st_size - DATA_OFFSET) % 16 != 0) {
+        errno = EINVAL;
+        goto fail;
+    }
+
+    res->map_len = (size_t) st.st_size;
+    res->map = mmap(NULL, res->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, res->fd, 0);
+    if (res->map == MAP_FAILED) {
+        res->map = NULL;
+        goto fail;
+    }
+
+    const reservoir_header *hdr = header(res);
+    if (memcmp(hdr->magic, RESERVOIR_MAGIC, sizeof(hdr->magic)) != 0 ||
+        hdr->blocks != (uint64_t) (st.st_size - DATA_OFFSET) / 16 || hdr->consumed > hdr->blocks) {
+        errno = EINVAL;
+        goto fail;
+    }
+    return res;
+
+fail:
+    if (res->map) {
+        munmap(res->map, res->map_len);
+    }
+    if (res->fd >= 0) {
+        close(res->fd);
+    }
+    free(res);
+    return NULL;
+}
+
+uint64_t ofb_reservoir_remaining(const ofb_reservoir *res)
+{
+    const reservoir_header *hdr = header(res);
+
+    return 16 * (hdr->blocks - hdr->consumed);
+}
+
+int ofb_reservoir_begin(ofb_reservoir *res, uint64_t len, uint8_t *iv)
+{
+    const uint64_t need = len / 16 + (len % 16 != 0);
+    reservoir_header *hdr = header(res);
+
+    // Whatever the previous message left unused is gone for good
+    memset(block(res, res->next), 0, 16 * (res->end - res->next));
+    res->next = res->end = 0;
+    res->ended = 0;
+
+    if (flock(res->fd, LOCK_EX) != 0) {
+        return -1;
+    }
+    const uint64_t first = hdr->consumed;
+    if (need > hdr->blocks - first) {
+        flock(res->fd, LOCK_UN);
+        errno = ENOSPC;
+        return -1;
+    }
+
+    // Move the marker past this message and make it durable before any of
+    // the keystream is used
+    aes128_ctx ctx;
+    aes128_init(&ctx, hdr->mask);
+    aes128e_block(&ctx, iv, hdr->next_iv);
+    ofb_wipe(&ctx, sizeof(ctx));
+    if (need > 0) {
+        memcpy(hdr->next_iv, block(res, first + need - 1), 16);
+    }
+    hdr->consumed = first + need;
+    int result = msync(res->map, DATA_OFFSET, MS_SYNC);
+    flock(res->fd, LOCK_UN);
+    if (result != 0) {
+        return -1;
+    }
+
+    res->next = first;
+    res->end = first + need;
+    return 0;
+}
+
+void ofb_reservoir_iv(uint8_t *iv, const uint8_t *published, const uint8_t *key)
+{
+    aes128d_ctx ctx;
+
+    ofb_unmask_init(&ctx, MASK_LABEL, key);
+    aes128d_block(&ctx, iv, published);
+    ofb_wipe(&ctx, sizeof(ctx));
+}
+
+int ofb_reservoir_update(ofb_reservoir *res, uint8_t *out, const uint8_t *in, size_t len)
+{
+    const uint64_t need = len / 16 + (len % 16 != 0);
+
+    // The rest of a partly used block is wiped, so nothing may follow it
+    if (res->ended) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (need > res->end - res->next) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    uint8_t *keystream = block(res, res->next);
+    ofb_xor_span(out, in, keystream, len);
+    memset(keystream, 0, 16 * need);
+    res->next += need;
+    res->ended = len % 16 != 0;
+    return 0;
+}
+
+void ofb_reservoir_close(ofb_reservoir *res)
+{
+    memset(block(res, res->next), 0, 16 * (res->end - res->next));
+    munmap(res->map, res->map_len);
+    close(res->fd);
+    free(res);
+}
@@ -0,0 +1,40 @@
+/********************************************************************************
+ * ofb_secret.c
+ *
+ * Masking-key derivation shared by the sidecar files (ofb_index.c,
+ * ofb_state.c, ofb_reservoir.c), and the wipe used by them and by the stream
+ * modes.
+ ********************************************************************************/
+
+#include "ofb_secret.h"
+
+void ofb_wipe(void *p, size_t len)
+{
+    volatile uint8_t *v = (volatile uint8_t *) p;
+    for (size_t i = 0; i < len; ++i) {
+        v[i] = 0;
+    }
+}
+
+void ofb_mask_key(uint8_t *mask, const uint8_t *label, const uint8_t *key)
+{
+    aes128e(mask, label, key);
+}
+
+void ofb_mask_init(aes128_ctx *ctx, const uint8_t *label, const uint8_t *key)
+{
+    uint8_t mask[16];
+
+    ofb_mask_key(mask, label, key);
+    aes128_init(ctx, mask);
+    ofb_wipe(mask, sizeof(mask));
+}
+
+void ofb_unmask_init(aes128d_ctx *ctx, const uint8_t *label, const uint8_t *key)
+{
+    uint8_t mask[16];
+
+    ofb_mask_key(mask, label, key);
+    aes128d_init(ctx, mask);
+    ofb_wipe(mask, sizeof(mask));
+}
@@ -0,0 +1,40 @@
+/*
+ * ofb_secret.h
+ * ------------
+ * Internal helpers for the sidecar files that keep secrets next to the
+ * ciphertext (the checkpoint index, the saved stream state and the keystream
+ * reservoir): deriving the key that masks feedback values, and wiping key
+ * material and keystream from memory (also used by the stream modes). This
+ * header is not part of the public interface in include/.
+ */
+#ifndef OFB_SECRET_H
+#define OFB_SECRET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../include/aes128e.h"
+#include "../include/aes128d.h"
+
+/*
+ * ofb_wipe zeroes len bytes at p in a way the compiler may not drop as a
+ * dead store.
+ */
+void ofb_wipe(void *p, size_t len);
+
+/*
+ * ofb_mask_key derives the 16-byte masking key E_K(label) of a sidecar file.
+ * Each file kind has a label of its own, so values masked for one kind are
+ * unrelated to those of another; a label is not a feedback value except with
+ * negligible probability, so the masking key is unrelated to the keystream.
+ */
+void ofb_mask_key(uint8_t *mask, const uint8_t *label, const uint8_t *key);
+
+/*
+ * ofb_mask_init and ofb_unmask_init fill ctx for masking (encrypting) or
+ * unmasking (decrypting) under E_K(label). The intermediate masking key is
+ * wiped; the caller wipes ctx when done with it.
+ */
+void ofb_mask_init(aes128_ctx *ctx, const uint8_t *label, const uint8_t *key);
+void ofb_unmask_init(aes128d_ctx *ctx, const uint8_t *label, const uint8_t *key);
+
+#endif // OFB_SECRET_H
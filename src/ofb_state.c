@@ -0,0 +1,113 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/aes128e.h"
+#include "../include/aes128d.h"
+#include "../include/obf.h"
+#include "../include/ofb_state.h"
+#include "ofb_secret.h"
+
+/*
+ * AES-128 OFB Saved Stream State
+ * ------------------------------
+ * File layout (integers in host byte order):
+ *
+ *   magic "OFBSTA1\0", length (8 bytes each)
+ *   E_m(IV)          verifies key and IV on load
+ *   E_m(feedback)    the feedback register
+ *
+ * The position within the block is not stored: after length bytes it is
+ * length % 16, or 16 at a block boundary. m is the masking key
+ * E_K(MASK_LABEL) set up by ofb_mask_init() and ofb_unmask_init().
+ */
+
+#define STATE_MAGIC "OFBSTA1"
+
+static const uint8_t MASK_LABEL[16] = "OFB saved state";
+
+// Bytes of the feedback register used after length bytes of stream
+static unsigned used_at(uint64_t length)
+{
+    return length % 16 ? (unsigned) (length % 16) : 16;
+}
+
+int ofb_state_save(const char *path, const ofb_state *state, uint64_t length,
+                   const uint8_t *key, const uint8_t *iv)
+{
+    uint8_t blocks[32];
+    aes128_ctx ctx;
+
+    if (state->used != used_at(length)) {
+        errno = EINVAL;
+        return -1;
+    }
+    size_t path_len = strlen(path);
+    char *tmp_path = malloc(path_len + 5);
+    if (!tmp_path) {
+        return -1;
+    }
+    memcpy(tmp_path, path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", 5);
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        free(tmp_path);
+        return -1;
+    }
+
+    ofb_mask_init(&ctx, MASK_LABEL, key);
+    memcpy(blocks, iv, 16);
+    memcpy(blocks + 16, state->feedback, 16);
+    aes128e_blocks(&ctx, blocks, blocks, 2);
+    ofb_wipe(&ctx, sizeof(ctx));
+
+    // The new state must be on disk before it replaces the old one
+    int failed = fwrite(STATE_MAGIC, 1, 8, f) != 8 || fwrite(&length, sizeof(length), 1, f) != 1 ||
+                 fwrite(blocks, 1, 32, f) != 32 || fflush(f) != 0 || fsync(fileno(f)) != 0;
+    if (fclose(f) != 0) {
+        failed = 1;
+    }
+    if (failed || rename(tmp_path, path) != 0) {
+        int saved = errno;
+        remove(tmp_path);
+        errno = saved;
+        failed = 1;
+    }
+    free(tmp_path);
+    return failed ? -1 : 0;
+}
+
+int ofb_state_load(const char *path, ofb_state *state, uint64_t *length,
+                   const uint8_t *key, const uint8_t *iv)
+{
+    char magic[8];
+    uint8_t blocks[32];
+    aes128d_ctx ctx;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return -1;
+    }
+    int valid = fread(magic, 1, 8, f) == 8 && memcmp(magic, STATE_MAGIC, 8) == 0 &&
+                fread(length, sizeof(*length), 1, f) == 1 && fread(blocks, 1, 32, f) == 32 &&
+                fgetc(f) == EOF;
+    fclose(f);
+
+    if (valid) {
+        ofb_unmask_init(&ctx, MASK_LABEL, key);
+        aes128d_blocks(&ctx, blocks, blocks, 2);
+        ofb_wipe(&ctx, sizeof(ctx));
+        valid = memcmp(blocks, iv, 16) == 0;
+    }
+    if (!valid) {
+        ofb_wipe(blocks, sizeof(blocks));
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(state->feedback, blocks + 16, 16);
+    state->used = used_at(*length);
+    ofb_wipe(blocks, sizeof(blocks));
+    return 0;
+}
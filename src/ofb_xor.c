@@ -0,0 +1,150 @@
+/********************************************************************************
+ * ofb_xor.c
+ *
+ * Keystream XOR kernels. Each width has two variants:
+ *
+ *   - regular stores, with an in-place path: when out == in the buffer is
+ *     aligned to the vector width first, so every load and store of the
+ *     main loop is aligned and there is only one data stream besides the
+ *     keystream;
+ *   - non-temporal stores (MOVNTDQ and wider), with out aligned first as
+ *     those instructions require, and a store fence at the end so the data
+ *     is visible to other threads when the call returns.
+ *
+ * The vector kernels are compiled with per-function target attributes, as
+ * the AES engines are, so the rest of the project does not need -mavx2.
+ ********************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "ofb_xor.h"
+
+/*
+ * xor_words is the portable kernel and handles the unaligned heads and short
+ * tails of the vector kernels: 64-bit words through memcpy, then bytes.
+ */
+static void xor_words(uint8_t* out, const uint8_t* in, const uint8_t* keystream, size_t len) {
+    uint64_t a, k;
+
+    for (; len >= 8; len -= 8, out += 8, in += 8, keystream += 8) {
+        memcpy(&a, in, 8);
+        memcpy(&k, keystream, 8);
+        a ^= k;
+        memcpy(out, &a, 8);
+    }
+    for (size_t i = 0; i < len; ++i) {
+        out[i] = in[i] ^ keystream[i];
+    }
+}
+
+// Bytes before p reaches the next multiple of align (a power of two), capped at len
+static size_t head_bytes(const uint8_t* p, size_t align, size_t len) {
+    size_t head = (size_t) (-(uintptr_t) p & (align - 1));
+    return head < len ? head : len;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define SSE2_TARGET   __attribute__((target("sse2")))
+#define AVX2_TARGET   __attribute__((target("avx2")))
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+#define NO_CLEAR() ((void) 0)
+
+/*
+ * DEFINE_KERNELS generates the regular and non-temporal kernels for one
+ * vector width W with register type V. The main loops handle four vectors
+ * per iteration. CLEAR runs before returning to SSE code: GCC does not insert
+ * VZEROUPPER in target-attribute functions, and dirty upper halves would make
+ * every legacy-SSE AES-NI instruction that follows pay a merge penalty.
+ */
+#define DEFINE_KERNELS(name, TARGET, W, V, LOADU, LOAD, STOREU, STORE, STREAM, XOR, CLEAR)    \
+static TARGET void xor_##name(uint8_t* out, const uint8_t* in, const uint8_t* keystream,       \
+                              size_t len) {                                                    \
+    if (out == in) {                                                                           \
+        size_t head = head_bytes(out, W, len);                                                 \
+        xor_words(out, in, keystream, head);                                                   \
+        out += head; keystream += head; len -= head;                                           \
+        for (; len >= 4 * W; len -= 4 * W, out += 4 * W, keystream += 4 * W) {                 \
+            STORE((V*) out,           XOR(LOAD((const V*) out),           LOADU((const V*) keystream)));           \
+            STORE((V*) (out + W),     XOR(LOAD((const V*) (out + W)),     LOADU((const V*) (keystream + W))));     \
+            STORE((V*) (out + 2 * W), XOR(LOAD((const V*) (out + 2 * W)), LOADU((const V*) (keystream + 2 * W)))); \
+            STORE((V*) (out + 3 * W), XOR(LOAD((const V*) (out + 3 * W)), LOADU((const V*) (keystream + 3 * W)))); \
+        }                                                                                      \
+        for (; len >= W; len -= W, out += W, keystream += W) {                                 \
+            STORE((V*) out, XOR(LOAD((const V*) out), LOADU((const V*) keystream)));           \
+        }                                                                                      \
+        CLEAR();                                                                               \
+        xor_words(out, out, keystream, len);                                                   \
+        return;                                                                                \
+    }                                                                                          \
+    for (; len >= 4 * W; len -= 4 * W, out += 4 * W, in += 4 * W, keystream += 4 * W) {        \
+        STOREU((V*) out,           XOR(LOADU((const V*) in),           LOADU((const V*) keystream)));           \
+        STOREU((V*) (out + W),     XOR(LOADU((const V*) (in + W)),     LOADU((const V*) (keystream + W))));     \
+        STOREU((V*) (out + 2 * W), XOR(LOADU((const V*) (in + 2 * W)), LOADU((const V*) (keystream + 2 * W)))); \
+        STOREU((V*) (out + 3 * W), XOR(LOADU((const V*) (in + 3 * W)), LOADU((const V*) (keystream + 3 * W)))); \
+    }                                                                                          \
+    for (; len >= W; len -= W, out += W, in += W, keystream += W) {                            \
+        STOREU((V*) out, XOR(LOADU((const V*) in), LOADU((const V*) keystream)));              \
+    }                                                                                          \
+    CLEAR();                                                                                   \
+    xor_words(out, in, keystream, len);                                                        \
+}                                                                                              \
+                                                                                               \
+static TARGET void xor_##name##_stream(uint8_t* out, const uint8_t* in, const uint8_t* keystream, \
+                                       size_t len) {                                           \
+    size_t head = head_bytes(out, W, len);                                                     \
+    xor_words(out, in, keystream, head);                                                       \
+    out += head; in += head; keystream += head; len -= head;                                   \
+    for (; len >= W; len -= W, out += W, in += W, keystream += W) {                            \
+        STREAM((V*) out, XOR(LOADU((const V*) in), LOADU((const V*) keystream)));              \
+    }                                                                                          \
+    _mm_sfence();                                                                              \
+    CLEAR();                                                                                   \
+    xor_words(out, in, keystream, len);                                                        \
+}
+
+DEFINE_KERNELS(sse2, SSE2_TARGET, 16, __m128i, _mm_loadu_si128, _mm_load_si128,
+               _mm_storeu_si128, _mm_store_si128, _mm_stream_si128, _mm_xor_si128, NO_CLEAR)
+DEFINE_KERNELS(avx2, AVX2_TARGET, 32, __m256i, _mm256_loadu_si256, _mm256_load_si256,
+               _mm256_storeu_si256, _mm256_store_si256, _mm256_stream_si256, _mm256_xor_si256,
+               _mm256_zeroupper)
+DEFINE_KERNELS(avx512, AVX512_TARGET, 64, __m512i, _mm512_loadu_si512, _mm512_load_si512,
+               _mm512_storeu_si512, _mm512_store_si512, _mm512_stream_si512, _mm512_xor_si512,
+               _mm256_zeroupper)
+
+#endif
+
+static void (*xor_kernel)(uint8_t*, const uint8_t*, const uint8_t*, size_t) = xor_words;
+static void (*xor_stream_kernel)(uint8_t*, const uint8_t*, const uint8_t*, size_t) = xor_words;
+
+/*
+ * The widest kernel is picked once at program start. __builtin_cpu_supports
+ * also checks that the OS saves the wider registers (XGETBV), which a plain
+ * CPUID test would not.
+ */
+__attribute__((constructor)) static void resolve_xor(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        xor_kernel = xor_avx512;
+        xor_stream_kernel = xor_avx512_stream;
+    } else if (__builtin_cpu_supports("avx2")) {
+        xor_kernel = xor_avx2;
+        xor_stream_kernel = xor_avx2_stream;
+    } else if (__builtin_cpu_supports("sse2")) {
+        xor_kernel = xor_sse2;
+        xor_stream_kernel = xor_sse2_stream;
+    }
+#endif
+}
+
+void ofb_xor(uint8_t* out, const uint8_t* in, const uint8_t* keystream, size_t len) {
+    xor_kernel(out, in, keystream, len);
+}
+
+void ofb_xor_stream(uint8_t* out, const uint8_t* in, const uint8_t* keystream, size_t len) {
+    xor_stream_kernel(out, in, keystream, len);
+}
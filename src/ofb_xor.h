@@ -0,0 +1,71 @@
+/*
+ * ofb_xor.h
+ * ---------
+ * Internal keystream XOR kernels shared by the stream front ends in src/
+ * (ofb_ctx, the pipelined and multi-buffer streams, the reservoir and CTR).
+ * The widest kernel the CPU supports (AVX-512, AVX2, SSE2 or 64-bit words)
+ * is chosen once at program start. This header is not part of the public
+ * interface in include/.
+ */
+#ifndef OFB_XOR_H
+#define OFB_XOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Out-of-place output at least this long is written with non-temporal
+ * stores: it will not be read back from cache, and streaming it past the
+ * cache keeps the key schedule and tables resident.
+ */
+#define OFB_XOR_STREAM_MIN (4 * 1024 * 1024)
+
+/*
+ * ofb_xor sets out = in ^ keystream over len bytes. out may be the same
+ * buffer as in (in-place), but the two must not otherwise overlap; the
+ * keystream must not overlap either.
+ */
+void ofb_xor(uint8_t *out, const uint8_t *in, const uint8_t *keystream, size_t len);
+
+/*
+ * ofb_xor_stream is ofb_xor with non-temporal stores to out.
+ */
+void ofb_xor_stream(uint8_t *out, const uint8_t *in, const uint8_t *keystream, size_t len);
+
+/*
+ * ofb_xor_block XORs a single 16-byte block, inline: two 64-bit words (memcpy
+ * keeps unaligned and aliased buffers well defined), which the compiler turns
+ * into one vector XOR.
+ */
+static inline void ofb_xor_block(uint8_t *out, const uint8_t *in, const uint8_t *keystream) {
+    uint64_t a[2], k[2];
+
+    memcpy(a, in, 16);
+    memcpy(k, keystream, 16);
+    a[0] ^= k[0];
+    a[1] ^= k[1];
+    memcpy(out, a, 16);
+}
+
+/*
+ * ofb_xor_streaming tells whether len bytes of output should bypass the
+ * cache. In place, each line has just been read into the cache anyway, and
+ * non-temporal stores only evict it early (measured slower at every size).
+ */
+static inline int ofb_xor_streaming(const uint8_t *out, const uint8_t *in, size_t len) {
+    return len >= OFB_XOR_STREAM_MIN && out != in;
+}
+
+/*
+ * ofb_xor_span picks ofb_xor or ofb_xor_stream as ofb_xor_streaming says.
+ */
+static inline void ofb_xor_span(uint8_t *out, const uint8_t *in, const uint8_t *keystream, size_t len) {
+    if (ofb_xor_streaming(out, in, len)) {
+        ofb_xor_stream(out, in, keystream, len);
+    } else {
+        ofb_xor(out, in, keystream, len);
+    }
+}
+
+#endif // OFB_XOR_H
@@ -0,0 +1,73 @@
+/********************************************************************************
+ * workers.c
+ *
+ * Segment thread pool for the parallel index, CTR and XTS paths.
+ ********************************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "workers.h"
+
+typedef struct {
+    segment_fn fn;
+    void *job;
+    uint64_t segments;
+    size_t buffer_size;
+    _Atomic uint64_t next;
+    _Atomic int failed;
+} pool;
+
+static void *worker(void *arg)
+{
+    pool *p = arg;
+    uint8_t *buffer = NULL;
+
+    if (p->buffer_size && !(buffer = malloc(p->buffer_size))) {
+        atomic_store(&p->failed, 1);
+        return NULL;
+    }
+    for (;;) {
+        uint64_t segment = atomic_fetch_add(&p->next, 1);
+        if (segment >= p->segments || atomic_load(&p->failed)) {
+            break;
+        }
+        if (p->fn(p->job, segment, buffer) != 0) {
+            atomic_store(&p->failed, 1);
+        }
+    }
+    free(buffer);
+    return NULL;
+}
+
+int run_segments(segment_fn fn, void *job, uint64_t segments, size_t buffer_size,
+                 unsigned threads)
+{
+    pthread_t workers[MAX_THREADS];
+    pool p = { .fn = fn, .job = job, .segments = segments, .buffer_size = buffer_size };
+    atomic_init(&p.next, 0);
+    atomic_init(&p.failed, 0);
+
+    if (threads > segments) {
+        threads = (unsigned) segments;
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+
+    // The calling thread is worker 0; if no thread can be started it does all the work
+    unsigned started = 0;
+    while (started + 1 < threads && pthread_create(&workers[started], NULL, worker, &p) == 0) {
+        ++started;
+    }
+    worker(&p);
+    for (unsigned i = 0; i < started; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+    if (atomic_load(&p.failed)) {
+        errno = EIO;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * workers.h
+ * ---------
+ * Internal thread pool shared by the parallel paths in src/ (checkpoint
+ * index decryption, CTR and XTS, in memory and on files): a range of work
+ * split into numbered segments that workers take from a shared counter. This
+ * header is not part of the public interface in include/.
+ */
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Most threads any parallel path runs, the caller included
+#define MAX_THREADS 64
+
+/*
+ * segment_fn processes one segment of job. buffer is the calling
+ * worker's own scratch space (NULL when none was asked for). Returns 0, or
+ * -1 to stop the job.
+ */
+typedef int (*segment_fn)(void *job, uint64_t segment, uint8_t *buffer);
+
+/*
+ * run_segments calls fn for segments 0 .. segments - 1 on up to threads
+ * threads (capped to segments and MAX_THREADS). The calling thread is
+ * worker 0 and does all the work if no thread can be started. Workers take
+ * the next segment from a shared counter, so a slow segment does not hold the
+ * others back; each gets a buffer_size-byte buffer if buffer_size is not 0.
+ *
+ * @return 0 on success, -1 if a segment failed or a buffer could not be
+ *         allocated (errno is EIO); no new segment is started after a failure
+ */
+int run_segments(segment_fn fn, void *job, uint64_t segments, size_t buffer_size,
+                 unsigned threads);
+
+#endif // WORKERS_H
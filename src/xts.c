@@ -0,0 +1,324 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/aes128e.h"
+#include "../include/aes128d.h"
+#include "../include/xts.h"
+#include "ofb_secret.h"
+#include "ofb_xor.h"
+#include "workers.h"
+
+// Blocks tweaked and encrypted per aes128e_blocks() call (4 KiB)
+#define XTS_SPAN_BLOCKS 256
+
+// Smallest share of an in-memory buffer worth a thread of its own
+#define XTS_MIN_RANGE (256 * 1024)
+
+// File ranges handed to workers, and the buffer each worker reads them
+// through; both are rounded to whole sectors
+#define XTS_SEGMENT_SIZE (1024 * 1024)
+#define XTS_BUFFER_SIZE (64 * 1024)
+
+// Little-endian 64-bit loads and stores; plain moves where the compiler has them
+static uint64_t load_le64(const uint8_t *p)
+{
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+#else
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) {
+        v = v << 8 | p[i];
+    }
+    return v;
+#endif
+}
+
+static void store_le64(uint8_t *p, uint64_t v)
+{
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(p, &v, 8);
+#else
+    for (int i = 0; i < 8; ++i) {
+        p[i] = (uint8_t) v;
+        v >>= 8;
+    }
+#endif
+}
+
+int xts_init(xts_ctx *ctx, const uint8_t *key, const uint8_t *tweak_key, size_t sector_size)
+{
+    if (sector_size < XTS_MIN_SECTOR_SIZE || sector_size > XTS_MAX_SECTOR_SIZE || sector_size % 16) {
+        return -1;
+    }
+    // K1 = K2 makes the first tweak E_K(s) and breaks the mode (IEEE 1619 5.1)
+    if (memcmp(key, tweak_key, 16) == 0) {
+        return -1;
+    }
+    aes128_init(&ctx->data, key);
+    aes128d_init_from(&ctx->data_dec, &ctx->data);
+    aes128_init(&ctx->tweak, tweak_key);
+    ctx->sector_size = sector_size;
+    return 0;
+}
+
+/*
+ * crypt_sectors handles a span of blocks at a time, which may cross sector
+ * boundaries: the tweaks E_K2(s) of the sectors starting in the span are
+ * encrypted in one batch, each block's tweak is written to a buffer
+ * (multiplying by alpha within a sector), and the span is then XORed,
+ * encrypted and XORed again in place in out.
+ */
+static void crypt_sectors(const xts_ctx *ctx, uint8_t *out, const uint8_t *in, uint64_t sector,
+                          size_t nsectors, int decrypt)
+{
+    _Alignas(64) uint8_t tweaks[XTS_SPAN_BLOCKS * 16];
+    _Alignas(64) uint8_t initial[XTS_SPAN_BLOCKS * 16];
+    const size_t sector_blocks = ctx->sector_size / 16;
+    size_t remaining = nsectors * sector_blocks;
+    size_t block = 0;  // position of the next block within its sector
+    size_t span = 0;   // largest span, to wipe the tweaks afterwards
+    uint64_t lo = 0, hi = 0;
+
+    while (remaining > 0) {
+        size_t n = remaining < XTS_SPAN_BLOCKS ? remaining : XTS_SPAN_BLOCKS;
+        if (n > span) {
+            span = n;
+        }
+
+        // Sectors starting inside this span
+        size_t first = block == 0 ? 0 : sector_blocks - block;
+        size_t starts = first < n ? (n - first - 1) / sector_blocks + 1 : 0;
+        memset(initial, 0, 16 * starts);
+        for (size_t i = 0; i < starts; ++i) {
+            store_le64(initial + 16 * i, sector + i);
+        }
+        aes128e_blocks(&ctx->tweak, initial, initial, starts);
+        sector += starts;
+
+        for (size_t i = 0, k = 0; i < n; ++i) {
+            if (block == 0) {
+                lo = load_le64(initial + 16 * k);
+                hi = load_le64(initial + 16 * k + 8);
+                ++k;
+            } else {
+                // T * alpha: a one-bit left shift of the little-endian value,
+                // reduced by x^128 = x^7 + x^2 + x + 1
+                uint64_t carry = hi >> 63;
+                hi = hi << 1 | lo >> 63;
+                lo = lo << 1 ^ (carry * 0x87);
+            }
+            store_le64(tweaks + 16 * i, lo);
+            store_le64(tweaks + 16 * i + 8, hi);
+            if (++block == sector_blocks) {
+                block = 0;
+            }
+        }
+
+        ofb_xor(out, in, tweaks, 16 * n);
+        if (decrypt) {
+            aes128d_blocks(&ctx->data_dec, out, out, n);
+        } else {
+            aes128e_blocks(&ctx->data, out, out, n);
+        }
+        ofb_xor(out, out, tweaks, 16 * n);
+        out += 16 * n;
+        in += 16 * n;
+        remaining -= n;
+    }
+    ofb_wipe(tweaks, 16 * span);
+    ofb_wipe(initial, 16 * span);
+}
+
+void xts_encrypt(const xts_ctx *ctx, uint8_t *out, const uint8_t *in, uint64_t sector, size_t nsectors)
+{
+    crypt_sectors(ctx, out, in, sector, nsectors, 0);
+}
+
+void xts_decrypt(const xts_ctx *ctx, uint8_t *out, const uint8_t *in, uint64_t sector, size_t nsectors)
+{
+    crypt_sectors(ctx, out, in, sector, nsectors, 1);
+}
+
+/*
+ * In-memory parallelism: one contiguous sector range per thread, as for
+ * CTR's counter ranges.
+ */
+typedef struct {
+    const xts_ctx *ctx;
+    uint8_t *out;
+    const uint8_t *in;
+    uint64_t sector;
+    size_t nsectors, share;
+    unsigned ranges;
+    int decrypt;
+} range_job;
+
+static int crypt_range(void *arg, uint64_t range, uint8_t *buffer)
+{
+    const range_job *job = arg;
+    const size_t first = (size_t) range * job->share, skip = first * job->ctx->sector_size;
+
+    (void) buffer;
+    crypt_sectors(job->ctx, job->out + skip, job->in + skip, job->sector + first,
+                  range + 1 < job->ranges ? job->share : job->nsectors - first, job->decrypt);
+    return 0;
+}
+
+static void crypt_parallel(const xts_ctx *ctx, uint8_t *out, const uint8_t *in, uint64_t sector,
+                           size_t nsectors, unsigned threads, int decrypt)
+{
+    if (threads > nsectors * ctx->sector_size / XTS_MIN_RANGE) {
+        threads = (unsigned) (nsectors * ctx->sector_size / XTS_MIN_RANGE);
+    }
+    if (threads > nsectors) {
+        threads = (unsigned) nsectors;
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+    if (threads <= 1) {
+        crypt_sectors(ctx, out, in, sector, nsectors, decrypt);
+        return;
+    }
+
+    // Whole sectors per range, the remainder going to the last one
+    range_job job = {
+        .ctx = ctx, .out = out, .in = in, .sector = sector, .nsectors = nsectors,
+        .share = nsectors / threads, .ranges = threads, .decrypt = decrypt,
+    };
+    run_segments(crypt_range, &job, threads, 0, threads);
+}
+
+void xts_encrypt_parallel(const xts_ctx *ctx, uint8_t *out, const uint8_t *in, uint64_t sector,
+                          size_t nsectors, unsigned threads)
+{
+    crypt_parallel(ctx, out, in, sector, nsectors, threads, 0);
+}
+
+void xts_decrypt_parallel(const xts_ctx *ctx, uint8_t *out, const uint8_t *in, uint64_t sector,
+                          size_t nsectors, unsigned threads)
+{
+    crypt_parallel(ctx, out, in, sector, nsectors, threads, 1);
+}
+
+// Whole sectors in n bytes, at least one
+static size_t sectors_in(const xts_ctx *ctx, size_t n)
+{
+    return n / ctx->sector_size > 0 ? n / ctx->sector_size : 1;
+}
+
+int xts_read_sectors(const xts_ctx *ctx, int fd, uint8_t *plaintext, uint64_t sector, size_t nsectors)
+{
+    const size_t step = sectors_in(ctx, XTS_BUFFER_SIZE);
+
+    while (nsectors > 0) {
+        size_t count = nsectors < step ? nsectors : step;
+        size_t n = count * ctx->sector_size;
+        ssize_t got = pread(fd, plaintext, n, (off_t) (sector * ctx->sector_size));
+        if (got != (ssize_t) n) {
+            if (got >= 0) {
+                errno = EIO;
+            }
+            return -1;
+        }
+        crypt_sectors(ctx, plaintext, plaintext, sector, count, 1);
+        plaintext += n;
+        sector += count;
+        nsectors -= count;
+    }
+    return 0;
+}
+
+int xts_write_sectors(const xts_ctx *ctx, int fd, const uint8_t *plaintext, uint64_t sector, size_t nsectors)
+{
+    const size_t step = sectors_in(ctx, XTS_BUFFER_SIZE);
+    uint8_t *buffer = malloc(step * ctx->sector_size);
+    int result = 0;
+
+    if (!buffer) {
+        return -1;
+    }
+    while (nsectors > 0 && result == 0) {
+        size_t count = nsectors < step ? nsectors : step;
+        size_t n = count * ctx->sector_size;
+        crypt_sectors(ctx, buffer, plaintext, sector, count, 0);
+        ssize_t put = pwrite(fd, buffer, n, (off_t) (sector * ctx->sector_size));
+        if (put != (ssize_t) n) {
+            if (put >= 0) {
+                errno = EIO;
+            }
+            result = -1;
+        }
+        plaintext += n;
+        sector += count;
+        nsectors -= count;
+    }
+    free(buffer);
+    return result;
+}
+
+void xts_final(xts_ctx *ctx)
+{
+    ofb_wipe(ctx, sizeof(*ctx));
+}
+
+/*
+ * File parallelism: segment g covers the sectors of bytes [offset + g *
+ * segment, offset + (g + 1) * segment) of the input, as for CTR's file
+ * segments; the key is shared.
+ */
+typedef struct {
+    int in_fd, out_fd;
+    const xts_ctx *ctx;
+    uint64_t offset, length, segment;
+    size_t buffer_size;
+    int decrypt;
+} crypt_job;
+
+static int crypt_segment(void *arg, uint64_t segment, uint8_t *buffer)
+{
+    const crypt_job *job = arg;
+    const xts_ctx *ctx = job->ctx;
+    uint64_t pos = segment * job->segment;
+    uint64_t end = pos + job->segment < job->length ? pos + job->segment : job->length;
+
+    while (pos < end) {
+        size_t n = end - pos < job->buffer_size ? (size_t) (end - pos) : job->buffer_size;
+        if (pread(job->in_fd, buffer, n, (off_t) (job->offset + pos)) != (ssize_t) n) {
+            return -1;
+        }
+        crypt_sectors(ctx, buffer, buffer, (job->offset + pos) / ctx->sector_size, n / ctx->sector_size,
+                      job->decrypt);
+        if (pwrite(job->out_fd, buffer, n, (off_t) pos) != (ssize_t) n) {
+            return -1;
+        }
+        pos += n;
+    }
+    return 0;
+}
+
+int xts_crypt_fd(int in_fd, int out_fd, const xts_ctx *ctx, uint64_t offset, uint64_t length,
+                 unsigned threads, int decrypt)
+{
+    struct stat st;
+    const uint64_t segment = sectors_in(ctx, XTS_SEGMENT_SIZE) * ctx->sector_size;
+    crypt_job job = {
+        .in_fd = in_fd, .out_fd = out_fd, .ctx = ctx, .offset = offset, .length = length,
+        .segment = segment, .buffer_size = sectors_in(ctx, XTS_BUFFER_SIZE) * ctx->sector_size,
+        .decrypt = decrypt,
+    };
+
+    if (fstat(in_fd, &st) != 0) {
+        return -1;
+    }
+    if (offset % ctx->sector_size || length % ctx->sector_size ||
+        offset > (uint64_t) st.st_size || length > (uint64_t) st.st_size - offset) {
+        errno = EINVAL;
+        return -1;
+    }
+    return run_segments(crypt_segment, &job, (length + segment - 1) / segment, job.buffer_size, threads);
+}
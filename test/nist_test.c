@@ -5,58 +5,144 @@
  *   This file validates the AES-128 encryption in OFB mode implementation
  *   using a test vector provided by NIST (SP 800-38A, F.4.1).
  *   It compares the actual output against the expected ciphertext and
- *   prints whether the test passed or failed.
+ *   prints whether the test passed or failed. The vector is run once for
+ *   every AES-128 block engine, since all of them must agree, together with
+ *   the FIPS-197 Appendix C block cipher examples for every key size.
  *
  * Usage:
  *   Compile and run this file to verify the correctness of OFBaes128e().
  */
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "../include/aes128e.h"
+#include "../include/aes128d.h"
 #include "../include/obf.h"
+#include "../include/ofb_pipe.h"
+#include "../include/ofb_reservoir.h"
+#include "../include/ofb_index.h"
+#include "../include/ofb_state.h"
+#include "../include/ofb_cmac.h"
+#include "../include/ctr.h"
+#include "../include/gcm.h"
+#include "../include/xts.h"
+#include "../src/ofb_xor.h"
+#include "../src/gcm_impl.h"
 
-int main() {
-    // 128-bit AES key taken from NIST test vector
-    uint8_t key[16] = {
-        0x2b, 0x7e, 0x15, 0x16,
-        0x28, 0xae, 0xd2, 0xa6,
-        0xab, 0xf7, 0x15, 0x88,
-        0x09, 0xcf, 0x4f, 0x3c
-    };
-
-    // Initialization Vector (IV) as specified by NIST
-    uint8_t iv[16] = {
-        0x00, 0x01, 0x02, 0x03,
-        0x04, 0x05, 0x06, 0x07,
-        0x08, 0x09, 0x0a, 0x0b,
-        0x0c, 0x0d, 0x0e, 0x0f
-    };
-
-    // Plaintext input from the NIST test vector (64 bytes)
-    uint8_t plaintext[64] = {
-        0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
-        0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
-        0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
-        0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
-        0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
-        0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
-        0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
-        0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
-    };
-
-    // Expected ciphertext output from the NIST test vector
-    uint8_t expected[64] = {
-        0x3b, 0x3f, 0xd9, 0x2e, 0xb7, 0x2d, 0xad, 0x20,
-        0x33, 0x34, 0x49, 0xf8, 0xe8, 0x3c, 0xfb, 0x4a,
-        0x77, 0x89, 0x50, 0x8d, 0x16, 0x91, 0x8f, 0x03,
-        0xf5, 0x3c, 0x52, 0xda, 0xc5, 0x4e, 0xd8, 0x25,
-        0x97, 0x40, 0x05, 0x1e, 0x9c, 0x5f, 0xec, 0xf6,
-        0x43, 0x44, 0xf7, 0xa8, 0x22, 0x60, 0xed, 0xcc,
-        0x30, 0x4c, 0x65, 0x28, 0xf6, 0x59, 0xc7, 0x78,
-        0x66, 0xa5, 0x10, 0xd9, 0xc1, 0xd6, 0xae, 0x5e
-    };
+static int failures = 0;
+
+// 128-bit AES key taken from NIST test vector
+static const uint8_t key[16] = {
+    0x2b, 0x7e, 0x15, 0x16,
+    0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88,
+    0x09, 0xcf, 0x4f, 0x3c
+};
+
+// Initialization Vector (IV) as specified by NIST
+static const uint8_t iv[16] = {
+    0x00, 0x01, 0x02, 0x03,
+    0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b,
+    0x0c, 0x0d, 0x0e, 0x0f
+};
+
+// Plaintext input from the NIST test vector (64 bytes)
+static const uint8_t plaintext[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+    0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+    0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+    0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+    0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+
+// Expected ciphertext output from the NIST test vector
+static const uint8_t expected[64] = {
+    0x3b, 0x3f, 0xd9, 0x2e, 0xb7, 0x2d, 0xad, 0x20,
+    0x33, 0x34, 0x49, 0xf8, 0xe8, 0x3c, 0xfb, 0x4a,
+    0x77, 0x89, 0x50, 0x8d, 0x16, 0x91, 0x8f, 0x03,
+    0xf5, 0x3c, 0x52, 0xda, 0xc5, 0x4e, 0xd8, 0x25,
+    0x97, 0x40, 0x05, 0x1e, 0x9c, 0x5f, 0xec, 0xf6,
+    0x43, 0x44, 0xf7, 0xa8, 0x22, 0x60, 0xed, 0xcc,
+    0x30, 0x4c, 0x65, 0x28, 0xf6, 0x59, 0xc7, 0x78,
+    0x66, 0xa5, 0x10, 0xd9, 0xc1, 0xd6, 0xae, 0x5e
+};
+
+// Uneven chunk sizes for the streaming tests, 64 bytes in all
+static const size_t chunks[] = { 1, 5, 10, 16, 17, 0, 3, 12 };
+
+// FIPS-197 Appendix C key bytes 00 01 02 ... 1f, shared by the key sizes
+static const uint8_t fips_key[32] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
+};
+
+// FIPS-197 Appendix C plaintext 00 11 22 ... ff and its AES-128 ciphertext
+static const uint8_t fips_plaintext[16] = {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+static const uint8_t fips_aes128[16] = {
+    0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+    0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+/*
+ * check compares len bytes of output against the wanted value, prints
+ * whether the named test passed and dumps both buffers on failure.
+ */
+static int check(const char *test, const char *backend,
+                 const uint8_t *output, const uint8_t *want, size_t len) {
+    if (memcmp(output, want, len) == 0) {
+        printf("%s PASSED (%s).\n", test, backend);
+        return 1;
+    }
+
+    failures++;
+    printf("%s FAILED (%s).\n", test, backend);
+    printf("Expected:\n");
+    for (size_t i = 0; i < len; i++) printf("%02X ", want[i]);
+    printf("\nGot:\n");
+    for (size_t i = 0; i < len; i++) printf("%02X ", output[i]);
+    printf("\n");
+    return 0;
+}
+
+/*
+ * check_true reports a test whose outcome is a single condition.
+ */
+static int check_true(const char *test, const char *backend, int cond) {
+    if (cond) {
+        printf("%s PASSED (%s).\n", test, backend);
+        return 1;
+    }
+
+    failures++;
+    printf("%s FAILED (%s).\n", test, backend);
+    return 0;
+}
+
+/*
+ * keystream_block recovers OFB output block i from a known plaintext and
+ * ciphertext pair.
+ */
+static const uint8_t *keystream_block(const uint8_t *ct, const uint8_t *pt, int i) {
+    static uint8_t block[16];
+    for (int j = 0; j < 16; j++) block[j] = ct[16 * i + j] ^ pt[16 * i + j];
+    return block;
+}
 
+/*
+ * test_ofb runs the NIST vector through the one-shot and streaming OFB
+ * interfaces under one engine, and returns 0 if the vector itself fails.
+ */
+static int test_ofb(const char *backend) {
     // Buffer to hold the ciphertext produced by OFBaes128e
     uint8_t output[64] = {0};
     uint8_t iv_copy[16];
@@ -65,17 +151,978 @@ int main() {
     OFBaes128e(output, plaintext, 64, iv_copy, key);
 
     // Compare output with expected ciphertext and report result
-    int match = memcmp(output, expected, 64);
-    if (match == 0) {
-        printf("NIST test vector PASSED.\n");
+    if (!check("NIST test vector", backend, output, expected, 64)) {
+        return 0;
+    }
+
+    // Two one-shot calls of 32 bytes continue the stream through iv_copy
+    memcpy(iv_copy, iv, 16);
+    OFBaes128e(output, plaintext, 32, iv_copy, key);
+    OFBaes128e(output + 32, plaintext + 32, 32, iv_copy, key);
+    check("OFB IV continuation", backend, output, expected, 64);
+
+    // The same vector streamed in uneven chunks, in place
+    ofb_ctx stream;
+    size_t offset = 0;
+    memcpy(output, plaintext, 64);
+    ofb_init(&stream, key, iv);
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); ++c) {
+        ofb_update(&stream, output + offset, output + offset, chunks[c]);
+        offset += chunks[c];
+    }
+    ofb_final(&stream, iv_copy);
+    check("OFB streaming", backend, output, expected, 64);
+
+    // ... and leaves the last keystream block O4 as the feedback value
+    check("OFB final feedback", backend, iv_copy, keystream_block(expected, plaintext, 3), 16);
+    return 1;
+}
+
+/*
+ * test_multi runs the multi-buffer OFB test under one engine.
+ */
+static void test_multi(const char *backend) {
+    // Multi-buffer OFB over 11 streams (a full and a partial group) with
+    // their own keys, IVs, lengths and leftover keystream must match
+    // separate ofb_update() calls; stream 0 is the NIST vector
+    enum { STREAMS = 11, STREAM_MAX = 100 };
+    ofb_ctx multi[STREAMS], single;
+    ofb_ctx *multi_ptrs[STREAMS];
+    uint8_t multi_in[STREAMS][STREAM_MAX];
+    uint8_t multi_out[STREAMS][STREAM_MAX] = {{0}}, single_out[STREAMS][STREAM_MAX] = {{0}};
+    uint8_t *out_ptrs[STREAMS];
+    const uint8_t *in_ptrs[STREAMS];
+    size_t lens[STREAMS];
+    for (int s = 0; s < STREAMS; s++) {
+        uint8_t stream_key[16], stream_iv[16];
+        const size_t warmup = (size_t) (s % 3) * 5;
+        for (int i = 0; i < 16; i++) {
+            stream_key[i] = (uint8_t) (key[i] + s);
+            stream_iv[i] = (uint8_t) (iv[i] ^ (s * 0x35));
+        }
+        for (int i = 0; i < STREAM_MAX; i++) {
+            multi_in[s][i] = s ? (uint8_t) (i * 7 + s) : plaintext[i % 64];
+        }
+        lens[s] = s ? (size_t) (s * 9) : 64;
+
+        ofb_init(&single, stream_key, stream_iv);
+        ofb_update(&single, single_out[s], multi_in[s], warmup + lens[s]);
+        ofb_final(&single, NULL);
+
+        ofb_init(&multi[s], stream_key, stream_iv);
+        ofb_update(&multi[s], multi_out[s], multi_in[s], warmup);
+        multi_ptrs[s] = &multi[s];
+        out_ptrs[s] = multi_out[s] + warmup;
+        in_ptrs[s] = multi_in[s] + warmup;
+    }
+    ofb_update_multi(multi_ptrs, out_ptrs, in_ptrs, lens, STREAMS);
+    check("Multi-buffer OFB", backend, multi_out[0], expected, 64);
+    check("Multi-buffer OFB streams", backend, multi_out[0], single_out[0], sizeof(multi_out));
+}
+
+/*
+ * test_pipe runs the pipelined OFB tests under one engine.
+ */
+static void test_pipe(const char *backend) {
+    uint8_t output[64], feedback[16], last_block[16];
+    ofb_ctx stream;
+
+    // Pipelined OFB: the NIST vector in uneven chunks, then a stream that
+    // wraps the ring several times against ofb_update()
+    ofb_pipe *pipe = ofb_pipe_start(key, iv);
+    if (!pipe) {
+        return;
+    }
+    const size_t long_len = 3 * OFB_PIPE_BLOCKS * 16 + 7;
+    uint8_t *long_in = calloc(long_len, 1), *long_out = malloc(long_len), *long_ref = malloc(long_len);
+
+    size_t offset = 0;
+    memcpy(output, plaintext, 64);
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); ++c) {
+        ofb_pipe_update(pipe, output + offset, output + offset, chunks[c]);
+        offset += chunks[c];
+    }
+    check("Pipelined OFB", backend, output, expected, 64);
+
+    ofb_init(&stream, key, iv);
+    ofb_update(&stream, long_ref, plaintext, 64);
+    ofb_update(&stream, long_ref, long_in, long_len);
+    ofb_final(&stream, last_block);
+    for (size_t done = 0; done < long_len; done += 1000) {
+        size_t n = long_len - done < 1000 ? long_len - done : 1000;
+        ofb_pipe_update(pipe, long_out + done, long_in + done, n);
+    }
+    ofb_pipe_finish(pipe, feedback);
+    check("Pipelined OFB long stream", backend, long_out, long_ref, long_len);
+    check("Pipelined OFB final feedback", backend, feedback, last_block, 16);
+    free(long_in);
+    free(long_out);
+    free(long_ref);
+
+    // A consumer that stalls long enough for the producer to fill the
+    // ring and go to sleep must wake it again, and finishing must wake
+    // a producer asleep on a full ring
+    pipe = ofb_pipe_start(key, iv);
+    if (pipe) {
+        memcpy(output, plaintext, 64);
+        usleep(20000);
+        ofb_pipe_update(pipe, output, output, 16);
+        usleep(20000);
+        ofb_pipe_update(pipe, output + 16, output + 16, 48);
+        usleep(20000);
+        ofb_pipe_finish(pipe, feedback);
+        check("Pipelined OFB after a stall", backend, output, expected, 64);
+    }
+}
+
+/*
+ * test_reservoir runs the keystream reservoir tests under one engine.
+ */
+static void test_reservoir(const char *backend) {
+    uint8_t output[64];
+    ofb_ctx stream;
+
+    // Keystream reservoir: the NIST vector XORed against pre-generated
+    // keystream, then a second message that continues from O4 and can be
+    // decrypted with ofb_init(key, unmasked IV)
+    const char *reservoir_path = "nist_reservoir.tmp";
+    ofb_reservoir *res = NULL;
+    if (ofb_reservoir_create(reservoir_path, key, iv, 100) == 0 &&
+        (res = ofb_reservoir_open(reservoir_path)) != NULL) {
+        uint8_t res_iv[16], res_out[36], res_back[36], o4[16];
+        for (int i = 0; i < 16; i++) o4[i] = expected[48 + i] ^ plaintext[48 + i];
+        ofb_reservoir_begin(res, 64, res_iv);
+        ofb_reservoir_update(res, output, plaintext, 64);
+        check("Reservoir OFB", backend, output, expected, 64);
+        ofb_reservoir_iv(res_iv, res_iv, key);
+        check("Reservoir IV", backend, res_iv, iv, 16);
+
+        ofb_reservoir_begin(res, 36, res_iv);
+        ofb_reservoir_update(res, res_out, fips_key, 32);
+        ofb_reservoir_update(res, res_out + 32, fips_key + 32 - 4, 4);
+        ofb_reservoir_iv(res_iv, res_iv, key);
+        check("Reservoir next IV", backend, res_iv, o4, 16);
+        ofb_init(&stream, key, res_iv);
+        ofb_update(&stream, res_back, res_out, 36);
+        ofb_final(&stream, NULL);
+        memcpy(res_out, fips_key, 32);
+        memcpy(res_out + 32, fips_key + 28, 4);
+        check("Reservoir decrypt", backend, res_back, res_out, 36);
+
+        // 100 bytes hold 7 blocks; 4 + 3 are used, so nothing is left
+        check_true("Reservoir exhaustion", backend, ofb_reservoir_begin(res, 1, res_iv) != 0);
+        ofb_reservoir_close(res);
     } else {
-        printf("NIST test vector FAILED.\n");
-        printf("Expected:\n");
-        for (int i = 0; i < 64; i++) printf("%02X ", expected[i]);
-        printf("\nGot:\n");
-        for (int i = 0; i < 64; i++) printf("%02X ", output[i]);
-        printf("\n");
+        failures++;
+        printf("Reservoir OFB FAILED (%s): cannot create %s.\n", backend, reservoir_path);
     }
+    remove(reservoir_path);
 
-    return 0;
+    // A call that takes part of a block ends the message: the rest of
+    // that block is wiped, so a further call must fail even with keystream
+    // still reserved, until the next ofb_reservoir_begin()
+    if (ofb_reservoir_create(reservoir_path, key, iv, 64) == 0 &&
+        (res = ofb_reservoir_open(reservoir_path)) != NULL) {
+        uint8_t res_iv[16];
+        int res_ok = ofb_reservoir_begin(res, 48, res_iv) == 0;
+        res_ok &= ofb_reservoir_update(res, output, plaintext, 16) == 0;
+        res_ok &= ofb_reservoir_update(res, output + 16, plaintext + 16, 5) == 0;
+        errno = 0;
+        res_ok &= ofb_reservoir_update(res, output + 21, plaintext + 21, 11) == -1 && errno == EINVAL;
+        res_ok &= ofb_reservoir_update(res, output + 21, plaintext + 21, 0) == -1 && errno == EINVAL;
+        res_ok &= ofb_reservoir_begin(res, 16, res_iv) == 0;
+        res_ok &= ofb_reservoir_update(res, output, plaintext + 48, 16) == 0 &&
+                  memcmp(output, expected + 48, 16) == 0;
+        check_true("Reservoir partial block", backend, res_ok);
+        ofb_reservoir_close(res);
+    }
+    remove(reservoir_path);
+
+    // The published IV of a message is masked: it must never equal a
+    // keystream block handed out before it (the previous message's last block
+    // would give away that message's last plaintext block), nor the raw IV
+    static const size_t message_lengths[] = { 16, 40, 33, 1, 48 };
+    enum { RESERVOIR_BLOCKS = 11 };
+    if (ofb_reservoir_create(reservoir_path, key, iv, 16 * RESERVOIR_BLOCKS) == 0 &&
+        (res = ofb_reservoir_open(reservoir_path)) != NULL) {
+        const uint8_t zeros[48] = {0};
+        uint8_t used[16 * RESERVOIR_BLOCKS], res_iv[16];
+        size_t used_blocks = 0;
+        int res_ok = 1;
+        for (size_t m = 0; m < sizeof(message_lengths) / sizeof(message_lengths[0]); ++m) {
+            const size_t len = message_lengths[m];
+            res_ok &= ofb_reservoir_begin(res, len, res_iv) == 0;
+            res_ok &= memcmp(res_iv, iv, 16) != 0;
+            for (size_t i = 0; i < used_blocks; i++) {
+                res_ok &= memcmp(res_iv, used + 16 * i, 16) != 0;
+            }
+            // Encrypting zeros hands out the keystream itself
+            memset(used + 16 * used_blocks, 0, 16 * ((len + 15) / 16));
+            res_ok &= ofb_reservoir_update(res, used + 16 * used_blocks, zeros, len) == 0;
+            used_blocks += (len + 15) / 16;
+        }
+        check_true("Reservoir IV masking", backend, res_ok && used_blocks == RESERVOIR_BLOCKS);
+        ofb_reservoir_close(res);
+    } else {
+        failures++;
+        printf("Reservoir IV masking FAILED (%s): cannot create %s.\n", backend, reservoir_path);
+    }
+    remove(reservoir_path);
+}
+
+/*
+ * test_index runs the checkpoint index and seekable reader tests under one
+ * engine.
+ */
+static void test_index(const char *backend) {
+    uint8_t output[64];
+
+    // Checkpoint index over the NIST vector, one checkpoint per block:
+    // the stored file must not contain the keystream, loading must give
+    // back O1..O4, and segment-parallel decryption must give the plaintext
+    const char *index_path = "nist_index.tmp", *cipher_path = "nist_cipher.tmp",
+               *plain_path = "nist_plain.tmp";
+    ofb_index index, loaded;
+    uint8_t index_file[256], decrypted[64] = {0};
+    FILE *f;
+    ofb_index_init(&index, 16);
+    for (int i = 0; i < 4; i++) ofb_index_add(&index, keystream_block(expected, plaintext, i));
+    index.length = 64;
+    int in_fd = -1, out_fd = -1;
+    if (ofb_index_save(index_path, &index, key, iv) == 0 && (f = fopen(index_path, "rb")) != NULL) {
+        size_t size = fread(index_file, 1, sizeof(index_file), f);
+        fclose(f);
+        int masked = 1;
+        for (size_t i = 0; i + 16 <= size; i++) {
+            for (int k = 0; k < 4; k++) {
+                masked &= memcmp(index_file + i, index.checkpoints + 16 * k, 16) != 0;
+            }
+        }
+        check_true("Checkpoint index masking", backend, masked);
+    }
+    if (ofb_index_load(index_path, &loaded, key, iv) == 0) {
+        check("Checkpoint index", backend, loaded.checkpoints, index.checkpoints, 64);
+        if ((f = fopen(cipher_path, "wb")) != NULL) {
+            fwrite(expected, 1, 64, f);
+            fclose(f);
+        }
+        in_fd = open(cipher_path, O_RDONLY);
+        out_fd = open(plain_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (in_fd >= 0 && out_fd >= 0 && ofb_index_decrypt(in_fd, out_fd, &loaded, key, iv, 3) == 0) {
+            pread(out_fd, decrypted, 64, 0);
+        }
+        check("Checkpoint parallel decrypt", backend, decrypted, plaintext, 64);
+
+        // Random access: forward into a later segment, back into the
+        // first one, and a reader without an index
+        ofb_reader reader;
+        memset(decrypted, 0, sizeof(decrypted));
+        ofb_reader_init(&reader, key, iv, &loaded);
+        ofb_seek(&reader, 40);
+        ofb_read(&reader, decrypted + 40, expected + 40, 20);
+        ofb_seek(&reader, 5);
+        ofb_read(&reader, decrypted + 5, expected + 5, 3);
+        ofb_reader_final(&reader);
+        ofb_reader_init(&reader, key, iv, NULL);
+        ofb_seek(&reader, 33);
+        ofb_read(&reader, decrypted + 33, expected + 33, 7);
+        ofb_reader_final(&reader);
+        memset(output, 0, 64);
+        memcpy(output + 5, plaintext + 5, 3);
+        memcpy(output + 33, plaintext + 33, 27);
+        check("Seekable OFB reader", backend, decrypted, output, 64);
+        ofb_index_free(&loaded);
+    } else {
+        failures++;
+        printf("Checkpoint index FAILED (%s): cannot load %s.\n", backend, index_path);
+    }
+    if (in_fd >= 0) close(in_fd);
+    if (out_fd >= 0) close(out_fd);
+    ofb_index_free(&index);
+    remove(index_path);
+    remove(cipher_path);
+    remove(plain_path);
+}
+
+/*
+ * test_state runs the saved state and resume test under one engine.
+ */
+static void test_state(const char *backend) {
+    uint8_t output[64];
+    ofb_ctx stream;
+
+    // Saved state: the NIST vector encrypted as 21 bytes, a state file
+    // saved mid-block, then the rest from a stream resumed from the file.
+    // The file must not load under another IV.
+    const char *state_path = "nist_state.tmp";
+    ofb_state saved;
+    uint64_t saved_length = 0;
+    ofb_init(&stream, key, iv);
+    ofb_update(&stream, output, plaintext, 21);
+    ofb_save(&stream, &saved);
+    ofb_final(&stream, NULL);
+    if (ofb_state_save(state_path, &saved, 21, key, iv) == 0 &&
+        ofb_state_load(state_path, &saved, &saved_length, key, iv) == 0 && saved_length == 21 &&
+        ofb_state_load(state_path, &saved, &saved_length, key, key) != 0 &&
+        ofb_resume(&stream, key, &saved) == 0) {
+        ofb_update(&stream, output + 21, plaintext + 21, 43);
+        ofb_final(&stream, NULL);
+        check("OFB resume from saved state", backend, output, expected, 64);
+    } else {
+        failures++;
+        printf("OFB saved state FAILED (%s).\n", backend);
+    }
+    remove(state_path);
+}
+
+/*
+ * test_iov runs the scatter-gather OFB tests under one engine.
+ */
+static void test_iov(const char *backend) {
+    ofb_ctx stream;
+
+    // Scatter-gather: input and output fragmented differently, with an
+    // empty fragment; lists of different totals are refused
+    uint8_t gathered[64];
+    const struct iovec in_iov[4] = {
+        { (void *) plaintext, 5 }, { (void *) (plaintext + 5), 0 },
+        { (void *) (plaintext + 5), 27 }, { (void *) (plaintext + 32), 32 },
+    };
+    const struct iovec out_iov[4] = {
+        { gathered, 16 }, { gathered + 16, 1 }, { gathered + 17, 40 }, { gathered + 57, 7 },
+    };
+    ofb_init(&stream, key, iv);
+    int iov_status = ofb_update_iov(&stream, in_iov, out_iov, 4);
+    iov_status |= ofb_update_iov(&stream, in_iov, out_iov, 3) != -1;
+
+    // Totals that wrap around to the same value are refused too
+    const struct iovec wrap_in[2] = { { gathered, SIZE_MAX }, { gathered, 2 } };
+    const struct iovec wrap_out[2] = { { gathered, 1 }, { gathered, 0 } };
+    iov_status |= ofb_update_iov(&stream, wrap_in, wrap_out, 2) != -1;
+    ofb_final(&stream, NULL);
+    check("OFB scatter-gather", backend, gathered, expected, 64);
+    check_true("OFB scatter-gather status", backend, iov_status == 0);
+}
+
+/*
+ * test_cmac runs the AES-CMAC and authenticated OFB tests under one engine.
+ */
+static void test_cmac(const char *backend) {
+    uint8_t output[64];
+    size_t offset;
+
+    // AES-CMAC, RFC 4493 examples 1-4: the NIST key over the first 0, 16,
+    // 40 and 64 bytes of the NIST plaintext, then example 4 in chunks
+    static const uint8_t cmac_tags[4][16] = {
+        { 0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28, 0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46 },
+        { 0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44, 0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c },
+        { 0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27 },
+        { 0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe },
+    };
+    static const size_t cmac_lengths[4] = { 0, 16, 40, 64 };
+    uint8_t tag[16], cmac_expected[4 * 16], cmac_output[4 * 16];
+    for (int m = 0; m < 4; m++) {
+        aes128_cmac(cmac_output + 16 * m, plaintext, cmac_lengths[m], key);
+        memcpy(cmac_expected + 16 * m, cmac_tags[m], 16);
+    }
+    check("AES-CMAC", backend, cmac_output, cmac_expected, sizeof(cmac_output));
+    aes128_cmac_ctx cmac;
+    aes128_cmac_init(&cmac, key);
+    offset = 0;
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); ++c) {
+        aes128_cmac_update(&cmac, plaintext + offset, chunks[c]);
+        offset += chunks[c];
+    }
+    aes128_cmac_final(&cmac, tag);
+    check("AES-CMAC streaming", backend, tag, cmac_tags[3], 16);
+
+    // Authenticated OFB: the NIST vector in chunks, whose tag must be the
+    // CMAC of the ciphertext under the MAC key; decryption in place must
+    // verify it, and reject it with one ciphertext bit flipped
+    ofb_cmac_ctx authenticated;
+    uint8_t mac_key[16], reference_tag[16];
+    for (int i = 0; i < 16; i++) mac_key[i] = (uint8_t) (0xa5 ^ i);
+    uint8_t mac_input[16 + 64];
+    memcpy(mac_input, iv, 16);
+    memcpy(mac_input + 16, expected, 64);
+    aes128_cmac(reference_tag, mac_input, sizeof(mac_input), mac_key);
+    ofb_cmac_init(&authenticated, key, mac_key, iv);
+    offset = 0;
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); ++c) {
+        ofb_cmac_encrypt(&authenticated, output + offset, plaintext + offset, chunks[c]);
+        offset += chunks[c];
+    }
+    ofb_cmac_final(&authenticated, tag);
+    check("OFB+CMAC ciphertext", backend, output, expected, 64);
+    check("OFB+CMAC tag", backend, tag, reference_tag, 16);
+    ofb_cmac_init(&authenticated, key, mac_key, iv);
+    ofb_cmac_decrypt(&authenticated, output, output, 64);
+    int verified = ofb_cmac_verify(&authenticated, tag) == 0;
+    uint8_t tampered[64];
+    memcpy(tampered, expected, 64);
+    tampered[37] ^= 0x04;
+    ofb_cmac_init(&authenticated, key, mac_key, iv);
+    ofb_cmac_decrypt(&authenticated, tampered, tampered, 64);
+    verified &= ofb_cmac_verify(&authenticated, tag) != 0;
+
+    // The IV is authenticated too: the right ciphertext under another IV fails
+    uint8_t other_iv[16];
+    memcpy(other_iv, iv, 16);
+    other_iv[0] ^= 0x80;
+    memcpy(tampered, expected, 64);
+    ofb_cmac_init(&authenticated, key, mac_key, other_iv);
+    ofb_cmac_decrypt(&authenticated, tampered, tampered, 64);
+    verified &= ofb_cmac_verify(&authenticated, tag) != 0;
+
+    // An empty message still has a tag, over the IV alone
+    uint8_t empty_tag[16];
+    aes128_cmac(reference_tag, iv, 16, mac_key);
+    ofb_cmac_init(&authenticated, key, mac_key, iv);
+    ofb_cmac_final(&authenticated, empty_tag);
+    verified &= memcmp(empty_tag, reference_tag, 16) == 0;
+    check("OFB+CMAC decrypt", backend, output, plaintext, 64);
+    check_true("OFB+CMAC verify", backend, verified);
+}
+
+/*
+ * test_ctr runs the CTR tests under one engine.
+ */
+static void test_ctr(const char *backend) {
+    uint8_t output[64], window[64];
+
+    // CTR, SP 800-38A F.5.1: one-shot with the counter advanced by four
+    // blocks, in chunks, and from a seek into the middle of a block
+    static const uint8_t ctr_expected[64] = {
+        0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26, 0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+        0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff, 0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+        0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e, 0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+        0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1, 0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee,
+    };
+    uint8_t ctr_counter[16], ctr_next[16];
+    for (int i = 0; i < 16; i++) ctr_counter[i] = (uint8_t) (0xf0 + i);
+    memcpy(ctr_next, ctr_counter, 16);
+    ctr_next[14] = 0xff;
+    ctr_next[15] = 0x03;
+    uint8_t ctr_iv[16];
+    memcpy(ctr_iv, ctr_counter, 16);
+    CTRaes128e(output, plaintext, 64, ctr_iv, key);
+    check("CTR test vector", backend, output, ctr_expected, 64);
+    check("CTR counter continuation", backend, ctr_iv, ctr_next, 16);
+
+    ctr_ctx ctr;
+    size_t offset = 0;
+    ctr_init(&ctr, key, ctr_counter);
+    memcpy(output, plaintext, 64);
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); ++c) {
+        ctr_update(&ctr, output + offset, output + offset, chunks[c]);
+        offset += chunks[c];
+    }
+    check("CTR streaming", backend, output, ctr_expected, 64);
+    memset(output, 0, 64);
+    ctr_seek(&ctr, 21);
+    ctr_update(&ctr, output + 21, plaintext + 21, 30);
+    ctr_final(&ctr);
+    memset(window, 0, 64);
+    memcpy(window + 21, ctr_expected + 21, 30);
+    check("CTR seek", backend, output, window, 64);
+
+    // Counter-range threads must match the serial stream, starting mid-block
+    const size_t ctr_len = 4 * 256 * 1024 + 77;
+    uint8_t *ctr_in = malloc(ctr_len), *ctr_out = malloc(ctr_len), *ctr_ref = malloc(ctr_len);
+    if (ctr_in && ctr_out && ctr_ref) {
+        for (size_t i = 0; i < ctr_len; i++) ctr_in[i] = (uint8_t) (i * 31);
+        ctr_init(&ctr, key, ctr_counter);
+        ctr_update(&ctr, ctr_ref, ctr_in, 5);
+        ctr_update(&ctr, ctr_ref + 5, ctr_in + 5, ctr_len - 5);
+        ctr_init(&ctr, key, ctr_counter);
+        ctr_update(&ctr, ctr_out, ctr_in, 5);
+        ctr_update_parallel(&ctr, ctr_out + 5, ctr_in + 5, ctr_len - 5, 4);
+        ctr_final(&ctr);
+        check("CTR parallel", backend, ctr_out, ctr_ref, ctr_len);
+    }
+    free(ctr_in);
+    free(ctr_out);
+    free(ctr_ref);
+}
+
+/*
+ * test_xts runs the XTS tests under one engine.
+ */
+static void test_xts(const char *backend) {
+    // Tweak key for the multi-sector and image tests
+    static const uint8_t tweak_key[16] = {
+        0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+    };
+    uint8_t output[64];
+
+    // XTS, IEEE 1619 vectors 2-3 (32-byte data units) both ways; vector 1
+    // has K1 = K2 = 0, which xts_init must refuse
+    static const uint8_t xts_keys[2][2][16] = {
+        {{0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11},
+         {0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22}},
+        {{0xff, 0xfe, 0xfd, 0xfc, 0xfb, 0xfa, 0xf9, 0xf8, 0xf7, 0xf6, 0xf5, 0xf4, 0xf3, 0xf2, 0xf1, 0xf0},
+         {0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22}},
+    };
+    static const uint8_t xts_expected[2][32] = {
+        {0xc4, 0x54, 0x18, 0x5e, 0x6a, 0x16, 0x93, 0x6e, 0x39, 0x33, 0x40, 0x38, 0xac, 0xef, 0x83, 0x8b,
+         0xfb, 0x18, 0x6f, 0xff, 0x74, 0x80, 0xad, 0xc4, 0x28, 0x93, 0x82, 0xec, 0xd6, 0xd3, 0x94, 0xf0},
+        {0xaf, 0x85, 0x33, 0x6b, 0x59, 0x7a, 0xfc, 0x1a, 0x90, 0x0b, 0x2e, 0xb2, 0x1e, 0xc9, 0x49, 0xd2,
+         0x92, 0xdf, 0x4c, 0x04, 0x7e, 0x0b, 0x21, 0x53, 0x21, 0x86, 0xa5, 0x97, 0x1a, 0x22, 0x7a, 0x89},
+    };
+    static const uint8_t zero_key[16] = {0};
+    xts_ctx xts;
+    check_true("XTS equal keys rejected", backend, xts_init(&xts, zero_key, zero_key, 32) != 0);
+    for (int v = 0; v < 2; v++) {
+        const uint64_t xts_sector = 0x3333333333ULL;
+        uint8_t xts_pt[32];
+        memset(xts_pt, 0x44, 32);
+        xts_init(&xts, xts_keys[v][0], xts_keys[v][1], 32);
+        xts_encrypt(&xts, output, xts_pt, xts_sector, 1);
+        check("XTS IEEE 1619 vector", backend, output, xts_expected[v], 32);
+        xts_decrypt(&xts, output, output, xts_sector, 1);
+        check("XTS IEEE 1619 vector decrypt", backend, output, xts_pt, 32);
+    }
+
+    // 48-byte sectors, so spans end mid-sector: one call must match a
+    // call per sector, in place and across threads
+    const size_t xts_sectors = 3 * 8192 + 7, xts_len = 48 * xts_sectors;
+    uint8_t *xts_in = malloc(xts_len), *xts_out = malloc(xts_len), *xts_ref = malloc(xts_len);
+    if (xts_in && xts_out && xts_ref) {
+        for (size_t i = 0; i < xts_len; i++) xts_in[i] = (uint8_t) (i * 17 + 9);
+        xts_init(&xts, key, tweak_key, 48);
+        for (size_t s = 0; s < xts_sectors; s++) {
+            xts_encrypt(&xts, xts_ref + 48 * s, xts_in + 48 * s, 1000 + s, 1);
+        }
+        memcpy(xts_out, xts_in, xts_len);
+        xts_encrypt(&xts, xts_out, xts_out, 1000, xts_sectors);
+        check("XTS multi-sector", backend, xts_out, xts_ref, xts_len);
+        xts_encrypt_parallel(&xts, xts_out, xts_in, 1000, xts_sectors, 4);
+        check("XTS parallel", backend, xts_out, xts_ref, xts_len);
+        xts_decrypt_parallel(&xts, xts_out, xts_ref, 1000, xts_sectors, 3);
+        check("XTS parallel decrypt", backend, xts_out, xts_in, xts_len);
+
+        // Image access: sectors written one range at a time must read
+        // back, and the whole image must decrypt through the file path
+        const char *image_path = "nist_image.tmp", *image_plain_path = "nist_image_plain.tmp";
+        int image_fd = open(image_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        int plain_fd = open(image_plain_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        int xts_ok = image_fd >= 0 && plain_fd >= 0 && xts_init(&xts, key, tweak_key, 512) == 0;
+        xts_ok &= xts_write_sectors(&xts, image_fd, xts_in + 512 * 5, 5, 40) == 0;
+        xts_ok &= xts_write_sectors(&xts, image_fd, xts_in, 0, 5) == 0;
+        xts_encrypt(&xts, xts_ref, xts_in, 0, 45);
+        xts_ok &= pread(image_fd, xts_out, 512 * 45, 0) == 512 * 45 && memcmp(xts_out, xts_ref, 512 * 45) == 0;
+        xts_ok &= xts_read_sectors(&xts, image_fd, xts_out, 7, 3) == 0 &&
+                  memcmp(xts_out, xts_in + 512 * 7, 512 * 3) == 0;
+        xts_ok &= xts_crypt_fd(image_fd, plain_fd, &xts, 512, 512 * 44, 2, 1) == 0 &&
+                  pread(plain_fd, xts_out, 512 * 44, 0) == 512 * 44 &&
+                  memcmp(xts_out, xts_in + 512, 512 * 44) == 0;
+        xts_ok &= xts_crypt_fd(image_fd, plain_fd, &xts, 100, 512, 1, 1) == -1;
+        xts_ok &= xts_read_sectors(&xts, image_fd, xts_out, 44, 2) == -1;
+        check_true("XTS sector I/O", backend, xts_ok);
+        if (image_fd >= 0) close(image_fd);
+        if (plain_fd >= 0) close(plain_fd);
+        remove(image_path);
+        remove(image_plain_path);
+    }
+    xts_final(&xts);
+    free(xts_in);
+    free(xts_out);
+    free(xts_ref);
+}
+
+/*
+ * test_block runs the FIPS-197 examples and the multi-block, multi-key and
+ * batched key expansion paths under one engine. fips_dctx was expanded
+ * under the startup engine.
+ */
+static void test_block(const char *backend, const aes128d_ctx *fips_dctx) {
+    static const uint8_t fips_aes192[16] = {
+        0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0,
+        0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91
+    };
+    static const uint8_t fips_aes256[16] = {
+        0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf,
+        0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89
+    };
+
+    // FIPS-197 Appendix C.1-C.3 single-block examples
+    uint8_t block[16];
+    aes128e(block, fips_plaintext, fips_key);
+    check("FIPS-197 AES-128", backend, block, fips_aes128, 16);
+    aes192e(block, fips_plaintext, fips_key);
+    check("FIPS-197 AES-192", backend, block, fips_aes192, 16);
+    aes256e(block, fips_plaintext, fips_key);
+    check("FIPS-197 AES-256", backend, block, fips_aes256, 16);
+    aes128d(block, fips_aes128, fips_key);
+    check("FIPS-197 AES-128 inverse", backend, block, fips_plaintext, 16);
+    aes128d_block(fips_dctx, block, fips_aes128);
+    check("FIPS-197 AES-128 inverse after engine switch", backend, block, fips_plaintext, 16);
+
+    // The OFB output blocks are E(IV), E(O1), E(O2), E(O3), so encrypting
+    // [IV, O1, O2, O3] as independent blocks must give [O1, O2, O3, O4].
+    // Three copies cover both full and partial multi-block groups.
+    uint8_t blocks_in[3 * 64], blocks_out[3 * 64], keystream[64];
+    aes128_ctx ctx;
+    for (int i = 0; i < 64; i++) keystream[i] = expected[i] ^ plaintext[i];
+    for (int r = 0; r < 3; r++) {
+        memcpy(blocks_in + 64 * r, iv, 16);
+        memcpy(blocks_in + 64 * r + 16, keystream, 48);
+    }
+    aes128_init(&ctx, key);
+    aes128e_blocks(&ctx, blocks_out, blocks_in, 12);
+    for (int r = 0; r < 3; r++) {
+        memcpy(blocks_in + 64 * r, keystream, 64);
+    }
+    check("Multi-block ECB", backend, blocks_out, blocks_in, sizeof(blocks_out));
+
+    // The same chain through the multi-key path, with every odd block
+    // replaced by the FIPS-197 plaintext under the FIPS-197 key
+    const aes128_ctx *ctxs[12];
+    aes128_ctx fips_ctx;
+    uint8_t multikey_expected[12 * 16];
+    aes128_init(&fips_ctx, fips_key);
+    for (int i = 0; i < 12; i++) {
+        const int k = i % 4;
+        ctxs[i] = (i & 1) ? &fips_ctx : &ctx;
+        memcpy(blocks_in + 16 * i, (i & 1) ? fips_plaintext : (k ? keystream + 16 * (k - 1) : iv), 16);
+        memcpy(multikey_expected + 16 * i, (i & 1) ? fips_aes128 : keystream + 16 * k, 16);
+    }
+    aes128e_multikey(ctxs, blocks_in, blocks_in, 12);
+    check("Multi-key ECB", backend, blocks_in, multikey_expected, sizeof(multikey_expected));
+
+    // Batched key expansion must match one-at-a-time expansion; 37 keys
+    // cover full and partial groups for every engine's batch width
+    uint8_t batch_keys[37 * 16];
+    aes128_ctx batch_ctxs[37], single_ctxs[37];
+    for (int i = 0; i < 37; i++) {
+        for (int j = 0; j < 16; j++) batch_keys[16 * i + j] = (uint8_t) (key[j] ^ (i * 0x1d + j));
+        aes128_init(&single_ctxs[i], batch_keys + 16 * i);
+    }
+    aes128_init_batch(batch_ctxs, batch_keys, 37);
+    check("Batched key expansion", backend, (const uint8_t *) batch_ctxs,
+          (const uint8_t *) single_ctxs, sizeof(batch_ctxs));
+
+    // ... and decrypting [O1, O2, O3, O4] must give back [IV, O1, O2, O3]
+    aes128d_ctx dctx;
+    aes128d_init_from(&dctx, &ctx);
+    aes128d_blocks(&dctx, blocks_in, blocks_out, 12);
+    for (int r = 0; r < 3; r++) {
+        memcpy(blocks_out + 64 * r, iv, 16);
+        memcpy(blocks_out + 64 * r + 16, keystream, 48);
+    }
+    check("Multi-block ECB inverse", backend, blocks_in, blocks_out, sizeof(blocks_in));
+}
+
+/*
+ * test_backend_override checks that AES_BACKEND selects the named engine.
+ */
+static void test_backend_override(const char *backend) {
+    // AES_BACKEND must select the same engine through the automatic choice
+    setenv("AES_BACKEND", backend, 1);
+    aes128_set_backend(AES128_BACKEND_AUTO);
+    check("AES_BACKEND override", backend,
+          (const uint8_t *) aes128_backend_name(aes128_get_backend()),
+          (const uint8_t *) backend, strlen(backend) + 1);
+    unsetenv("AES_BACKEND");
+}
+
+/*
+ * test_xts_constant_time decrypts XTS under each constant-time engine with
+ * keys expanded under another.
+ */
+static void test_xts_constant_time(void) {
+    // XTS keys set up under the portable engine, then decrypted on several
+    // threads under each constant-time engine, which must use its own
+    // inverse cipher rather than one chosen when the key was expanded
+    if (aes128_set_backend(AES128_BACKEND_PORTABLE) == 0) {
+        static const aes128_backend ct_backends[] = { AES128_BACKEND_BITSLICE, AES128_BACKEND_VPAES };
+        const size_t ct_sectors = 301, ct_len = 64 * ct_sectors;
+        uint8_t *ct_in = malloc(ct_len), *ct_enc = malloc(ct_len), *ct_out = malloc(ct_len);
+        xts_ctx ct_xts;
+        if (ct_in && ct_enc && ct_out && xts_init(&ct_xts, fips_key, fips_key + 16, 64) == 0) {
+            for (size_t i = 0; i < ct_len; i++) ct_in[i] = (uint8_t) (i * 31 + 7);
+            xts_encrypt(&ct_xts, ct_enc, ct_in, 77, ct_sectors);
+            for (size_t i = 0; i < sizeof(ct_backends) / sizeof(ct_backends[0]); ++i) {
+                const char *name = aes128_backend_name(ct_backends[i]);
+                if (aes128_set_backend(ct_backends[i]) != 0) {
+                    printf("XTS constant-time decrypt SKIPPED (%s not supported).\n", name);
+                    continue;
+                }
+                memset(ct_out, 0, ct_len);
+                xts_decrypt_parallel(&ct_xts, ct_out, ct_enc, 77, ct_sectors, 4);
+                check("XTS constant-time parallel decrypt", name, ct_out, ct_in, ct_len);
+                xts_decrypt(&ct_xts, ct_out, ct_enc + 64 * 5, 77 + 5, 1);
+                check("XTS constant-time decrypt", name, ct_out, ct_in + 64 * 5, 64);
+            }
+            xts_final(&ct_xts);
+        }
+        free(ct_in);
+        free(ct_enc);
+        free(ct_out);
+    }
+}
+
+/*
+ * test_gcm runs the GCM tests under one engine.
+ */
+static void test_gcm(const char *backend) {
+    uint8_t output[64], tag[16], decrypted[64];
+    size_t offset;
+
+    // GCM, test cases 1-4 of the GCM specification (McGrew and Viega):
+    // empty, one zero block, 64 bytes, and 60 bytes with 20 bytes of AAD
+    static const uint8_t gcm_key[16] = {
+        0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+    };
+    static const uint8_t gcm_iv[12] = {
+        0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88,
+    };
+    static const uint8_t gcm_pt[64] = {
+        0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5, 0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+        0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda, 0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+        0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+        0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57, 0xba, 0x63, 0x7b, 0x39, 0x1a, 0xaf, 0xd2, 0x55,
+    };
+    static const uint8_t gcm_ct[64] = {
+        0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24, 0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+        0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0, 0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+        0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c, 0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+        0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97, 0x3d, 0x58, 0xe0, 0x91, 0x47, 0x3f, 0x59, 0x85,
+    };
+    static const uint8_t gcm_aad_data[20] = {
+        0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+        0xab, 0xad, 0xda, 0xd2,
+    };
+    static const uint8_t gcm_zero_ct[16] = {
+        0x03, 0x88, 0xda, 0xce, 0x60, 0xb6, 0xa3, 0x92, 0xf3, 0x28, 0xc2, 0xb9, 0x71, 0xb2, 0xfe, 0x78,
+    };
+    static const uint8_t gcm_tags[4][16] = {
+        {0x58, 0xe2, 0xfc, 0xce, 0xfa, 0x7e, 0x30, 0x61, 0x36, 0x7f, 0x1d, 0x57, 0xa4, 0xe7, 0x45, 0x5a},
+        {0xab, 0x6e, 0x47, 0xd4, 0x2c, 0xec, 0x13, 0xbd, 0xf5, 0x3a, 0x67, 0xb2, 0x12, 0x57, 0xbd, 0xdf},
+        {0x4d, 0x5c, 0x2a, 0xf3, 0x27, 0xcd, 0x64, 0xa6, 0x2c, 0xf3, 0x5a, 0xbd, 0x2b, 0xa6, 0xfa, 0xb4},
+        {0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb, 0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47},
+    };
+    const uint8_t zeros[16] = {0};
+    aes128_gcm_encrypt(output, tag, NULL, 0, NULL, 0, zeros, 12, zeros);
+    check("GCM test case 1", backend, tag, gcm_tags[0], 16);
+    aes128_gcm_encrypt(output, tag, zeros, 16, NULL, 0, zeros, 12, zeros);
+    check("GCM test case 2", backend, output, gcm_zero_ct, 16);
+    check("GCM test case 2 tag", backend, tag, gcm_tags[1], 16);
+    aes128_gcm_encrypt(output, tag, gcm_pt, 64, NULL, 0, gcm_iv, 12, gcm_key);
+    check("GCM test case 3", backend, output, gcm_ct, 64);
+    check("GCM test case 3 tag", backend, tag, gcm_tags[2], 16);
+    aes128_gcm_encrypt(output, tag, gcm_pt, 60, gcm_aad_data, 20, gcm_iv, 12, gcm_key);
+    check("GCM test case 4", backend, output, gcm_ct, 60);
+    check("GCM test case 4 tag", backend, tag, gcm_tags[3], 16);
+
+    // Decryption in chunks, AAD included, and rejection of a changed tag
+    gcm_ctx gcm;
+    gcm_init(&gcm, gcm_key);
+    gcm_start(&gcm, gcm_iv, 12);
+    gcm_aad(&gcm, gcm_aad_data, 7);
+    gcm_aad(&gcm, gcm_aad_data + 7, 13);
+    offset = 0;
+    memset(decrypted, 0, 64);
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]) && offset < 60; ++c) {
+        size_t n = offset + chunks[c] > 60 ? 60 - offset : chunks[c];
+        gcm_decrypt(&gcm, decrypted + offset, gcm_ct + offset, n);
+        offset += n;
+    }
+    int gcm_ok = gcm_verify(&gcm, gcm_tags[3], 16) == 0 && offset == 60;
+    check("GCM streaming decrypt", backend, decrypted, gcm_pt, 60);
+    memcpy(tag, gcm_tags[3], 16);
+    tag[15] ^= 1;
+    gcm_ok &= aes128_gcm_decrypt(decrypted, gcm_ct, 60, gcm_aad_data, 20, tag, gcm_iv, 12, gcm_key) == -1;
+    gcm_ok &= aes128_gcm_decrypt(decrypted, gcm_ct, 60, gcm_aad_data, 20, gcm_tags[3], gcm_iv, 12, gcm_key) == 0;
+    check_true("GCM verify", backend, gcm_ok);
+    gcm_final(&gcm);
+
+    // Truncated tags: 12 to 16 bytes always, 8 and 4 only through
+    // gcm_verify_short, and no other length even with a matching prefix
+    gcm_ok = 1;
+    for (size_t len = 0; len <= 17; ++len) {
+        const int allowed = len >= 12 && len <= 16;
+        const int allowed_short = allowed || len == 8 || len == 4;
+        uint8_t long_tag[17];
+        memcpy(long_tag, gcm_tags[3], 16);
+        long_tag[16] = 0;
+        for (int short_ok = 0; short_ok < 2; ++short_ok) {
+            gcm_init(&gcm, gcm_key);
+            gcm_start(&gcm, gcm_iv, 12);
+            gcm_aad(&gcm, gcm_aad_data, 20);
+            gcm_decrypt(&gcm, decrypted, gcm_ct, 60);
+            const int r = short_ok ? gcm_verify_short(&gcm, long_tag, len) : gcm_verify(&gcm, long_tag, len);
+            gcm_ok &= r == ((short_ok ? allowed_short : allowed) ? 0 : -1);
+        }
+        if (len >= 4 && len <= 16) {
+            gcm_init(&gcm, gcm_key);
+            gcm_start(&gcm, gcm_iv, 12);
+            gcm_aad(&gcm, gcm_aad_data, 20);
+            gcm_decrypt(&gcm, decrypted, gcm_ct, 60);
+            long_tag[len - 1] ^= 0x80;
+            gcm_ok &= gcm_verify_short(&gcm, long_tag, len) == -1;
+        }
+    }
+    gcm_final(&gcm);
+    check_true("GCM tag lengths", backend, gcm_ok);
+
+    // SP 800-38D length limits, forced by starting one block short of
+    // the text limit: the last block fits, a byte more is refused and
+    // leaves the output alone; oversized one-shot calls fail up front
+    gcm_init(&gcm, gcm_key);
+    gcm_start(&gcm, gcm_iv, 12);
+    gcm.text_len = GCM_MAX_TEXT_LEN - 16;
+    memset(output, 0xa5, 17);
+    gcm_ok = gcm_encrypt(&gcm, output, gcm_pt, 17) == -1 && output[0] == 0xa5;
+    gcm_ok &= gcm_encrypt(&gcm, output, gcm_pt, 16) == 0 && memcmp(output, gcm_ct, 16) == 0;
+    gcm_ok &= gcm_encrypt(&gcm, output, gcm_pt, 1) == -1;
+    gcm_ok &= gcm_decrypt(&gcm, output, gcm_ct, 1) == -1;
+    gcm_finish(&gcm, tag, 16);
+    gcm_start(&gcm, gcm_iv, 12);
+    gcm_ok &= gcm_decrypt(&gcm, output, gcm_ct, SIZE_MAX) == -1;
+    gcm_ok &= gcm_aad(&gcm, gcm_aad_data, SIZE_MAX) == -1;
+    gcm_ok &= aes128_gcm_encrypt(output, tag, gcm_pt, 64, NULL, 0, gcm_iv, 0, gcm_key) == -1;
+    gcm_ok &= aes128_gcm_decrypt(output, gcm_ct, SIZE_MAX, NULL, 0, tag, gcm_iv, 12, gcm_key) == -1;
+    gcm_final(&gcm);
+    check_true("GCM length limits", backend, gcm_ok);
+
+    // A long message takes the stitched loop on AES-NI and the span loop
+    // elsewhere; every engine must give the first engine's ciphertext and
+    // tag, in one call and in odd-sized chunks
+    const size_t gcm_len = 4099;
+    uint8_t *gcm_in = malloc(gcm_len), *gcm_out = malloc(gcm_len);
+    if (gcm_in && gcm_out) {
+        static uint8_t gcm_ref[4099], gcm_ref_tag[16];
+        static int have_gcm_ref = 0;
+        for (size_t i = 0; i < gcm_len; i++) gcm_in[i] = (uint8_t) (i * 53 + 1);
+        aes128_gcm_encrypt(gcm_out, tag, gcm_in, gcm_len, gcm_aad_data, 20, key, 16, gcm_key);
+        if (!have_gcm_ref) {
+            memcpy(gcm_ref, gcm_out, gcm_len);
+            memcpy(gcm_ref_tag, tag, 16);
+            have_gcm_ref = 1;
+        }
+        check("GCM long message", backend, gcm_out, gcm_ref, gcm_len);
+        check("GCM long message tag", backend, tag, gcm_ref_tag, 16);
+
+        gcm_init(&gcm, gcm_key);
+        gcm_start(&gcm, key, 16);
+        gcm_aad(&gcm, gcm_aad_data, 20);
+        memcpy(gcm_out, gcm_in, gcm_len);
+        for (size_t pos = 0, n = 1; pos < gcm_len; pos += n, n = n * 3 + 5) {
+            if (n > gcm_len - pos) n = gcm_len - pos;
+            gcm_encrypt(&gcm, gcm_out + pos, gcm_out + pos, n);
+        }
+        gcm_finish(&gcm, tag, 16);
+        gcm_final(&gcm);
+        check("GCM long message in chunks", backend, gcm_out, gcm_ref, gcm_len);
+        check("GCM long message chunked tag", backend, tag, gcm_ref_tag, 16);
+        gcm_ok = aes128_gcm_decrypt(gcm_out, gcm_ref, gcm_len, gcm_aad_data, 20, gcm_ref_tag, key, 16, gcm_key) == 0;
+        gcm_ok &= memcmp(gcm_out, gcm_in, gcm_len) == 0;
+        check_true("GCM long message decrypt", backend, gcm_ok);
+    }
+    free(gcm_in);
+    free(gcm_out);
+}
+
+/*
+ * test_ghash checks the PCLMULQDQ GHASH against the 4-bit tables.
+ */
+static void test_ghash(void) {
+    // GHASH with PCLMULQDQ against the 4-bit tables, over block counts on
+    // both sides of the eight-block aggregation
+    if (ghash_clmul_supported()) {
+        _Alignas(16) uint8_t table_key[256], clmul_key[256];
+        uint8_t h[16], gin[37 * 16], x_table[16], x_clmul[16];
+        int ok = 1;
+        for (int i = 0; i < 16; i++) h[i] = (uint8_t) (i * 29 + 0x81);
+        for (size_t i = 0; i < sizeof(gin); i++) gin[i] = (uint8_t) (i * 11 + 5);
+        ghash_init_table(table_key, h);
+        ghash_init_clmul(clmul_key, h);
+        for (size_t n = 0; n <= 37; n += 3) {
+            memset(x_table, 0x5a, 16);
+            memset(x_clmul, 0x5a, 16);
+            ghash_blocks_table(table_key, x_table, gin, n);
+            ghash_blocks_clmul(clmul_key, x_clmul, gin, n);
+            ok &= memcmp(x_table, x_clmul, 16) == 0;
+        }
+        check_true("GHASH PCLMULQDQ", "ghash", ok);
+    }
+}
+
+/*
+ * test_xor_kernels checks the keystream XOR kernels against a byte loop, over
+ * lengths and offsets that exercise the unaligned heads and tails, in place
+ * and out of place.
+ */
+static void test_xor_kernels(void) {
+    uint8_t xin[600], xks[600], xout[600], xref[600];
+    int ok = 1;
+    for (int i = 0; i < 600; i++) {
+        xin[i] = (uint8_t) (i * 7 + 3);
+        xks[i] = (uint8_t) (i * 13 + 1);
+    }
+    for (size_t len = 0; len < 520 && ok; len += 37) {
+        for (size_t off = 0; off < 64 && ok; off += 9) {
+            for (size_t i = 0; i < len; i++) xref[i] = xin[off + i] ^ xks[i];
+            memset(xout, 0, sizeof(xout));
+            ofb_xor(xout + off, xin + off, xks, len);
+            ok &= memcmp(xout + off, xref, len) == 0;
+            ofb_xor_stream(xout + 1, xin + off, xks + off, len);
+            for (size_t i = 0; i < len; i++) xref[i] = xin[off + i] ^ xks[off + i];
+            ok &= memcmp(xout + 1, xref, len) == 0;
+            memcpy(xout, xin, sizeof(xout));
+            ofb_xor(xout + off, xout + off, xks + off, len);
+            ok &= memcmp(xout + off, xref, len) == 0;
+        }
+    }
+    check_true("Keystream XOR kernels", "xor", ok);
+}
+
+int main() {
+    static const struct {
+        aes128_backend backend;
+        const char *name;
+    } backends[] = {
+        { AES128_BACKEND_PORTABLE, "portable" },
+        { AES128_BACKEND_TTABLE,   "ttable"   },
+        { AES128_BACKEND_AESNI,    "aesni"    },
+        { AES128_BACKEND_BITSLICE, "bitslice" },
+        { AES128_BACKEND_VPAES,    "vpaes"    },
+    };
+    // Expanded once under the startup engine; decryption must follow every
+    // later change of engine without expanding it again
+    aes128d_ctx fips_dctx;
+    aes128d_init(&fips_dctx, fips_key);
+
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); ++b) {
+        const char *backend = backends[b].name;
+
+        if (aes128_set_backend(backends[b].backend) != 0) {
+            printf("NIST test vector SKIPPED (%s not supported).\n", backend);
+            continue;
+        }
+        if (!test_ofb(backend)) {
+            continue;
+        }
+        test_iov(backend);
+        test_multi(backend);
+        test_pipe(backend);
+        test_reservoir(backend);
+        test_index(backend);
+        test_state(backend);
+        test_cmac(backend);
+        test_ctr(backend);
+        test_gcm(backend);
+        test_xts(backend);
+        test_block(backend, &fips_dctx);
+        test_backend_override(backend);
+    }
+
+    test_xor_kernels();
+
+    test_ghash();
+
+    test_xts_constant_time();
+
+    return failures ? 1 : 0;
 }
@@ -65,6 +65,26 @@ run_test 16 15 true    # Borderline IV length
 echo "=== Testing Valid Case ==="
 run_test 16 16 false   # Valid case
 
+echo "=== Testing --threads ==="
+head -c 16 /dev/urandom > tmp_key.bin
+head -c 16 /dev/urandom > tmp_iv.bin
+for threads in "4x" "" "-2" "0" "65" "99999999999999999999" " 4"; do
+    echo -n "🔧 --threads '${threads}' → "
+    if ../aes_ofb -e -m ctr --threads "$threads" "$PLAINTEXT" "$OUTPUT" tmp_key.bin tmp_iv.bin > /dev/null 2>&1; then
+        echo "❌ FAIL: Should have rejected invalid thread count"
+        exit 1
+    fi
+    echo "✅ PASS (caught invalid)"
+done
+for threads in 1 64; do
+    echo -n "🔧 --threads ${threads} → "
+    if ! ../aes_ofb -e -m ctr --threads "$threads" "$PLAINTEXT" "$OUTPUT" tmp_key.bin tmp_iv.bin > /dev/null 2>&1; then
+        echo "❌ FAIL: Should have accepted valid thread count"
+        exit 1
+    fi
+    echo "✅ PASS (valid)"
+done
+
 # Cleanup
 rm -f tmp_key.bin tmp_iv.bin "$OUTPUT"
 rm -rf data/*  
@@ -76,6 +96,6 @@ make clean > /dev/null 2>&1
 cd - > /dev/null
 
 echo "=== Test Summary ==="
-echo "Total invalid cases tested: 7"
-echo "Total valid cases tested: 1"
+echo "Total invalid cases tested: 14"
+echo "Total valid cases tested: 3"
 echo "🎉 All tests passed successfully!"
\ No newline at end of file